@@ -0,0 +1,293 @@
+
+#include "Benchmark.hpp"
+#include "Components.hpp"
+#include "Parallel.hpp"
+#include "Octree.hpp"
+#include "Greedy.hpp"
+#include "CacheMisses.hpp"
+#include <sys/stat.h>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <complex>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <chrono>
+#include <cstdlib>
+
+
+const std::size_t MIN_BOX_SIZE = 4;
+const std::size_t MULTIBROT_DEPTH = 64; //iterations, far fewer than the generator's
+const char* const SLICE_DIRECTORY = "benchmark_slices";
+
+
+int main(int argc, char** argv)
+{
+    setThreadCount(getOption(argc, argv, "--threads", 0));
+    std::size_t maxSize = getOption(argc, argv, "--max-size", 256);
+
+#ifdef MORTON_VOLUME
+    std::cout << "Volume layout: Morton order." << std::endl;
+#else
+    std::cout << "Volume layout: linear bricks." << std::endl;
+#endif
+    std::cout << "shape     size  stage         seconds    Mvoxel/s     boxes  cache misses" << std::endl;
+
+    mkdir(SLICE_DIRECTORY, 0755);
+    for (std::size_t size = 64; size <= maxSize; size *= 2)
+    {
+        runStages("spheres", makeVolume(size, getSpheres(size)));
+        runStages("noise", makeVolume(size, getNoise(size)));
+        runStages("shells", makeVolume(size, getShells(size)));
+        runStages("multibrot", makeVolume(size, getMultibrot(size)));
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+
+//fills a size^3 volume one layer per task
+Volume makeVolume(std::size_t size, const Shape& isInside)
+{
+    Volume volume(size, size);
+    runInParallel(size, [&](std::size_t d) {
+        for (std::size_t x = 0; x < size; x++)
+            for (std::size_t y = 0; y < size; y++)
+                if (isInside(d, x, y))
+                    volume.set(d, x, y);
+    });
+
+    return volume;
+}
+
+
+
+//a cluster of overlapping balls, with a few small ones floating free as islands
+Shape getSpheres(std::size_t size)
+{
+    std::vector<std::array<float, 4>> balls;
+    unsigned int state = 12345;
+    auto random = [&]() {
+        state = state * 1103515245 + 12345;
+        return (float)((state >> 8) & 0xFFFF) / 65535.0f;
+    };
+
+    for (int j = 0; j < 12; j++)
+    {
+        float radius = (0.1f + 0.15f * random()) * (float)size;
+        balls.push_back({{ (0.3f + 0.4f * random()) * (float)size, (0.3f + 0.4f * random()) * (float)size,
+            (0.3f + 0.4f * random()) * (float)size, radius }});
+    }
+
+    for (int j = 0; j < 6; j++)
+        balls.push_back({{ (0.05f + 0.1f * random()) * (float)size, random() * (float)size,
+            random() * (float)size, 0.03f * (float)size + 1 }});
+
+    return [balls](std::size_t d, std::size_t x, std::size_t y) {
+        for (const auto& ball : balls)
+        {
+            float dd = (float)d - ball[0], dx = (float)x - ball[1], dy = (float)y - ball[2];
+            if (dd * dd + dx * dx + dy * dy <= ball[3] * ball[3])
+                return true;
+        }
+        return false;
+    };
+}
+
+
+
+//smooth value noise cut at its middle, giving many components of every size
+Shape getNoise(std::size_t size)
+{
+    std::size_t cell = std::max(size / 8, (std::size_t)4);
+    return [cell](std::size_t d, std::size_t x, std::size_t y) {
+        return getLatticeNoise(d, x, y, cell) > 0.5f;
+    };
+}
+
+
+
+//concentric shells with gaps between them, each its own component
+Shape getShells(std::size_t size)
+{
+    float center = (float)size / 2, spacing = (float)size / 10;
+    return [center, spacing](std::size_t d, std::size_t x, std::size_t y) {
+        float dd = (float)d - center, dx = (float)x - center, dy = (float)y - center;
+        float radius = std::sqrt(dd * dd + dx * dx + dy * dy);
+        int shell = (int)(radius / spacing);
+        return shell < 5 && radius - (float)shell * spacing < spacing / 2;
+    };
+}
+
+
+
+//the generator's fractal, sampled directly at this resolution and iteration depth
+Shape getMultibrot(std::size_t size)
+{
+    return [size](std::size_t d, std::size_t x, std::size_t y) {
+        float exponent = 1 + 32 * (float)(d + 1) / (float)size;
+        std::complex<float> c(4.0f * (float)x / (float)size - 2, 4.0f * (float)y / (float)size - 2);
+        std::complex<float> z(0, 0);
+        for (std::size_t i = 0; i < MULTIBROT_DEPTH; i++)
+        {
+            if (std::norm(z) >= 4)
+                return false;
+            z = std::pow(z, exponent) + c;
+        }
+        return true;
+    };
+}
+
+
+
+//trilinear interpolation of hashed values at the corners of the voxel's cell
+float getLatticeNoise(std::size_t d, std::size_t x, std::size_t y, std::size_t cell)
+{
+    auto corner = [](std::size_t cd, std::size_t cx, std::size_t cy) {
+        std::uint32_t hash = (std::uint32_t)(cd * 73856093u ^ cx * 19349663u ^ cy * 83492791u);
+        hash ^= hash >> 13;
+        hash *= 0x5bd1e995u;
+        hash ^= hash >> 15;
+        return (float)(hash & 0xFFFF) / 65535.0f;
+    };
+
+    std::size_t cd = d / cell, cx = x / cell, cy = y / cell;
+    float fd = (float)(d % cell) / (float)cell, fx = (float)(x % cell) / (float)cell, fy = (float)(y % cell) / (float)cell;
+
+    float value = 0;
+    for (int j = 0; j < 8; j++)
+    {
+        float weight = (j & 1 ? fd : 1 - fd) * (j & 2 ? fx : 1 - fx) * (j & 4 ? fy : 1 - fy);
+        value += weight * corner(cd + (j & 1), cx + ((j >> 1) & 1), cy + ((j >> 2) & 1));
+    }
+
+    return value;
+}
+
+
+
+//writes one slice file per layer in the generator's run-length format
+std::vector<std::string> writeSlices(const Volume& volume, const std::string& directory)
+{
+    std::vector<std::string> files;
+    for (std::size_t d = 0; d < volume.getHeight(); d++)
+    {
+        std::stringstream ss("");
+        ss << directory << "/slice" << d << ".dat";
+        files.push_back(ss.str());
+    }
+
+    runInParallel(volume.getHeight(), [&](std::size_t d) {
+        std::ofstream fout;
+        fout.open(files[d], std::ofstream::out);
+        for (std::size_t x = 0; x < volume.getSize(); x++)
+        {
+            bool inside = false;
+            std::size_t length = 0;
+            for (std::size_t y = 0; y < volume.getSize(); y++)
+            {
+                if (volume.get(d, x, y) != inside)
+                {
+                    fout << length << " ";
+                    inside = !inside;
+                    length = 0;
+                }
+                length++;
+            }
+            fout << length << " \n";
+        }
+        fout.close();
+    });
+
+    return files;
+}
+
+
+
+void runStages(const std::string& name, const Volume& volume)
+{
+    typedef std::chrono::steady_clock Clock;
+    std::size_t size = volume.getSize();
+    std::vector<std::string> files = writeSlices(volume, SLICE_DIRECTORY);
+
+    CacheMissCounter misses;
+    Clock::time_point start;
+    auto begin = [&]() {
+        misses.start();
+        start = Clock::now();
+    };
+    auto end = [&](const std::string& stage, std::size_t boxes) {
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        std::uint64_t count = misses.stop();
+        report(name, size, stage, seconds, boxes, count, misses.isAvailable());
+    };
+
+    begin();
+    Volume loaded = readMatrix(files, size);
+    end("load", 0);
+    if (!isSameVolume(loaded, volume))
+        std::cout << "  ERROR: the slices read back differ from the volume written!" << std::endl;
+
+    Volume seeded = loaded;
+    begin();
+    ComponentLabels labels(loaded);
+    labels.keep(loaded, selectComponents(labels.getComponents(), 0));
+    end("labels", 0);
+
+    std::size_t seedD, seedX, seedY;
+    if (findSeed(loaded, seedD, seedX, seedY))
+    {
+        begin();
+        removeIslands(seeded, seedD, seedX, seedY);
+        end("seed fill", 0);
+        if (!isSameVolume(loaded, seeded))
+            std::cout << "  ERROR: the seed fill kept other voxels than the labels!" << std::endl;
+    }
+
+    begin();
+    Octree octree(loaded, MIN_BOX_SIZE);
+    std::vector<Bounds2D> boxes = mergeRuns(octree.getFullNodes());
+    end("octree", boxes.size());
+    std::string coverage = checkCoverage(loaded, boxes, MIN_BOX_SIZE);
+    if (!coverage.empty())
+        std::cout << "  ERROR: octree boxes " << coverage << std::endl;
+
+    begin();
+    std::vector<Bounds2D> cuboids = findCuboids(loaded, MIN_BOX_SIZE);
+    end("greedy", cuboids.size());
+    coverage = checkCoverage(loaded, cuboids, MIN_BOX_SIZE);
+    if (!coverage.empty())
+        std::cout << "  ERROR: greedy boxes " << coverage << std::endl;
+
+    //writeGeometry reports its box count, which would break up the table
+    std::streambuf* console = std::cout.rdbuf(nullptr);
+    begin();
+    writeGeometry(listBoxes(boxes), std::string(SLICE_DIRECTORY) + "/geometry.dat");
+    writeBinaryGeometry(boxes, size, size, std::string(SLICE_DIRECTORY) + "/geometry.bin");
+    std::cout.rdbuf(console);
+    std::cout.clear();
+    end("write", boxes.size());
+
+    for (const auto& file : files)
+        std::remove(file.c_str());
+}
+
+
+
+void report(const std::string& name, std::size_t size, const std::string& stage,
+    double seconds, std::size_t boxes, std::uint64_t misses, bool countsMisses)
+{
+    double voxels = (double)size * (double)size * (double)size;
+    std::cout << std::left << std::setw(10) << name << std::right << std::setw(4) << size << "  " <<
+        std::left << std::setw(10) << stage << std::right << std::fixed << std::setprecision(4) <<
+        std::setw(10) << seconds << std::setprecision(1) << std::setw(12) << voxels / seconds / 1e6 <<
+        std::setw(10) << boxes << std::setw(14);
+    if (countsMisses)
+        std::cout << misses;
+    else
+        std::cout << "-";
+    std::cout << std::endl;
+}
@@ -0,0 +1,33 @@
+#ifndef BENCHMARK
+#define BENCHMARK
+
+/**
+    The benchmark runs the converter's stages on synthetic volumes from 64^3
+    up, so that their cost can be measured without a full 1024^3 run. Each
+    shape is written out as slices, read back, cleaned and turned into
+    boxes, and every stage reports its time, its rate in voxels per second
+    and, where perf events allow, its cache misses. The boxes are checked
+    against the cleaned volume: they must not overlap, must stay inside,
+    and must cover every full aligned block.
+**/
+
+#include "main.hpp"
+#include "Volume.hpp"
+#include <vector>
+#include <string>
+#include <functional>
+
+typedef std::function<bool(std::size_t d, std::size_t x, std::size_t y)> Shape;
+
+Volume makeVolume(std::size_t size, const Shape& isInside);
+Shape getSpheres(std::size_t size);
+Shape getNoise(std::size_t size);
+Shape getShells(std::size_t size);
+Shape getMultibrot(std::size_t size);
+float getLatticeNoise(std::size_t d, std::size_t x, std::size_t y, std::size_t cell);
+std::vector<std::string> writeSlices(const Volume& volume, const std::string& directory);
+void runStages(const std::string& name, const Volume& volume);
+void report(const std::string& name, std::size_t size, const std::string& stage,
+    double seconds, std::size_t boxes, std::uint64_t misses, bool countsMisses);
+
+#endif
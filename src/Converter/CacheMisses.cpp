@@ -0,0 +1,64 @@
+
+#include "CacheMisses.hpp"
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+
+
+CacheMissCounter::CacheMissCounter()
+{
+    perf_event_attr attributes;
+    std::memset(&attributes, 0, sizeof(attributes));
+    attributes.size = sizeof(attributes);
+    attributes.type = PERF_TYPE_HARDWARE;
+    attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+    attributes.disabled = 1;
+    attributes.inherit = 1; //threads created later count towards this one
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+
+    descriptor_ = (int)syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+}
+
+
+
+CacheMissCounter::~CacheMissCounter()
+{
+    if (descriptor_ >= 0)
+        close(descriptor_);
+}
+
+
+
+bool CacheMissCounter::isAvailable() const
+{
+    return descriptor_ >= 0;
+}
+
+
+
+void CacheMissCounter::start()
+{
+    if (descriptor_ < 0)
+        return;
+
+    ioctl(descriptor_, PERF_EVENT_IOC_RESET, 0);
+    ioctl(descriptor_, PERF_EVENT_IOC_ENABLE, 0);
+}
+
+
+
+//returns the misses since start(), or 0 if counting is unavailable
+std::uint64_t CacheMissCounter::stop()
+{
+    if (descriptor_ < 0)
+        return 0;
+
+    ioctl(descriptor_, PERF_EVENT_IOC_DISABLE, 0);
+    std::uint64_t misses = 0;
+    if (read(descriptor_, &misses, sizeof(misses)) != (ssize_t)sizeof(misses))
+        return 0;
+    return misses;
+}
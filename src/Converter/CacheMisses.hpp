@@ -0,0 +1,31 @@
+#ifndef CACHE_MISSES
+#define CACHE_MISSES
+
+/**
+    A CacheMissCounter counts the hardware cache misses of the converter
+    between start() and stop(), including those of worker threads started
+    in between, through Linux's perf events. Where those are unavailable,
+    such as in containers or with a restrictive perf_event_paranoid, the
+    counter reports itself as such and counts nothing.
+**/
+
+#include <cstdint>
+
+class CacheMissCounter
+{
+    public:
+        CacheMissCounter();
+        ~CacheMissCounter();
+
+        CacheMissCounter(const CacheMissCounter&) = delete;
+        CacheMissCounter& operator=(const CacheMissCounter&) = delete;
+
+        bool isAvailable() const;
+        void start();
+        std::uint64_t stop();
+
+    private:
+        int descriptor_;
+};
+
+#endif
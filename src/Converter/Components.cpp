@@ -0,0 +1,280 @@
+
+#include "Components.hpp"
+#include "Parallel.hpp"
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+
+const std::size_t MAX_RUNS = ~(std::uint32_t)0; //run indices, parents and labels are 32 bits
+
+
+ComponentLabels::ComponentLabels(const Volume& volume) :
+    height_(volume.getHeight()), size_(volume.getSize())
+{
+    std::size_t slabCount = std::min(getThreadCount(), height_);
+    std::vector<std::size_t> slabs = splitEvenly(height_, slabCount);
+
+    findRuns(volume, slabs);
+
+    labels_.resize(runs_.size());
+    std::iota(labels_.begin(), labels_.end(), 0);
+
+    //within a slab the unions only touch that slab's runs
+    runInParallel(slabCount, [&](std::size_t slab) {
+        for (std::size_t d = slabs[slab]; d < slabs[slab + 1]; d++)
+        {
+            for (std::size_t x = 0; x < size_; x++)
+            {
+                if (x > 0)
+                    joinRows(d * size_ + x, d * size_ + x - 1);
+                if (d > slabs[slab])
+                    joinRows(d * size_ + x, (d - 1) * size_ + x);
+            }
+        }
+    });
+
+    for (std::size_t slab = 1; slab < slabCount; slab++)
+        for (std::size_t x = 0; x < size_; x++)
+            joinRows(slabs[slab] * size_ + x, (slabs[slab] - 1) * size_ + x);
+
+    measure();
+}
+
+
+
+const std::vector<Component>& ComponentLabels::getComponents() const
+{
+    return components_;
+}
+
+
+
+//memory held by the runs, their labels and the components
+std::size_t ComponentLabels::getBytes() const
+{
+    return rowStarts_.capacity() * sizeof(std::size_t) + runs_.capacity() * sizeof(Run) +
+        labels_.capacity() * sizeof(std::uint32_t) + components_.capacity() * sizeof(Component);
+}
+
+
+
+//returns the runs of a row along with their components
+std::vector<std::pair<Run, std::uint32_t>> ComponentLabels::getRow(std::size_t d, std::size_t x) const
+{
+    std::vector<std::pair<Run, std::uint32_t>> row;
+    std::size_t index = d * size_ + x;
+    for (std::size_t j = rowStarts_[index]; j < rowStarts_[index + 1]; j++)
+        row.push_back(std::make_pair(runs_[j], labels_[j]));
+    return row;
+}
+
+
+
+//the voxel must be inside
+std::uint32_t ComponentLabels::getComponentAt(std::size_t d, std::size_t x, std::size_t y) const
+{
+    std::size_t index = d * size_ + x;
+    auto begin = runs_.begin() + (std::ptrdiff_t)rowStarts_[index];
+    auto end = runs_.begin() + (std::ptrdiff_t)rowStarts_[index + 1];
+    auto run = std::upper_bound(begin, end, (std::uint32_t)y, [](std::uint32_t value, const Run& r) {
+        return value < r.end_;
+    });
+    return labels_[(std::size_t)(run - runs_.begin())];
+}
+
+
+
+//rewrites the volume to hold only the components marked as kept
+void ComponentLabels::keep(Volume& volume, const std::vector<bool>& kept) const
+{
+    std::vector<std::size_t> slabs = splitEvenly(height_, std::min(getThreadCount(), height_));
+    runInParallel(slabs.size() - 1, [&](std::size_t slab) {
+        for (std::size_t d = slabs[slab]; d < slabs[slab + 1]; d++)
+        {
+            for (std::size_t x = 0; x < size_; x++)
+            {
+                for (std::size_t w = 0; w < volume.getRowWords(); w++)
+                    volume.getWord(d, x, w) = 0;
+
+                std::size_t row = d * size_ + x;
+                for (std::size_t j = rowStarts_[row]; j < rowStarts_[row + 1]; j++)
+                    if (kept[labels_[j]])
+                        volume.setRun(d, x, runs_[j].start_, runs_[j].end_ - runs_[j].start_);
+            }
+        }
+    });
+}
+
+
+
+void ComponentLabels::findRuns(const Volume& volume, const std::vector<std::size_t>& slabs)
+{
+    const std::size_t rowWords = volume.getRowWords();
+    rowStarts_.assign(height_ * size_ + 1, 0);
+
+    //count first, so that each slab knows where its runs go
+    runInParallel(slabs.size() - 1, [&](std::size_t slab) {
+        for (std::size_t d = slabs[slab]; d < slabs[slab + 1]; d++)
+        {
+            for (std::size_t x = 0; x < size_; x++)
+            {
+                std::size_t count = 0;
+                Volume::Word previous = 0;
+                for (std::size_t w = 0; w < rowWords; w++)
+                {
+                    Volume::Word word = volume.getWord(d, x, w);
+                    Volume::Word starts = word & ~((word << 1) | (previous >> (Volume::WORD_BITS - 1)));
+                    count += (std::size_t)__builtin_popcountll(starts);
+                    previous = word;
+                }
+                rowStarts_[d * size_ + x + 1] = count;
+            }
+        }
+    });
+
+    std::partial_sum(rowStarts_.begin(), rowStarts_.end(), rowStarts_.begin());
+    if (rowStarts_.back() > MAX_RUNS)
+        throw std::runtime_error("The volume has " + std::to_string(rowStarts_.back()) +
+            " runs, more than the " + std::to_string(MAX_RUNS) + " that can be labelled!");
+    runs_.resize(rowStarts_.back());
+
+    runInParallel(slabs.size() - 1, [&](std::size_t slab) {
+        for (std::size_t d = slabs[slab]; d < slabs[slab + 1]; d++)
+        {
+            for (std::size_t x = 0; x < size_; x++)
+            {
+                std::size_t next = rowStarts_[d * size_ + x];
+                std::uint32_t start = 0;
+                bool inside = false;
+                for (std::size_t w = 0; w < rowWords; w++)
+                {
+                    Volume::Word word = volume.getWord(d, x, w);
+                    std::size_t bit = 0;
+                    while (bit < Volume::WORD_BITS)
+                    {
+                        //look for the next change between outside and inside
+                        Volume::Word changes = (inside ? ~word : word) >> bit;
+                        if (changes == 0)
+                            break;
+
+                        bit += (std::size_t)__builtin_ctzll(changes);
+                        auto y = (std::uint32_t)(w * Volume::WORD_BITS + bit);
+                        if (inside)
+                            runs_[next++] = Run(start, y);
+                        else
+                            start = y;
+                        inside = !inside;
+                    }
+                }
+
+                if (inside)
+                    runs_[next++] = Run(start, (std::uint32_t)size_);
+            }
+        }
+    });
+}
+
+
+
+//joins the overlapping runs of two neighboring rows
+void ComponentLabels::joinRows(std::size_t rowA, std::size_t rowB)
+{
+    std::size_t a = rowStarts_[rowA], b = rowStarts_[rowB];
+    while (a < rowStarts_[rowA + 1] && b < rowStarts_[rowB + 1])
+    {
+        if (runs_[a].start_ < runs_[b].end_ && runs_[b].start_ < runs_[a].end_)
+            join((std::uint32_t)a, (std::uint32_t)b);
+
+        if (runs_[a].end_ < runs_[b].end_)
+            a++;
+        else
+            b++;
+    }
+}
+
+
+
+//roots always have the lowest index of their set
+void ComponentLabels::join(std::uint32_t runA, std::uint32_t runB)
+{
+    runA = find(runA);
+    runB = find(runB);
+    if (runA < runB)
+        labels_[runB] = runA;
+    else if (runB < runA)
+        labels_[runA] = runB;
+}
+
+
+
+std::uint32_t ComponentLabels::find(std::uint32_t run)
+{
+    while (labels_[run] != run)
+    {
+        labels_[run] = labels_[labels_[run]];
+        run = labels_[run];
+    }
+
+    return run;
+}
+
+
+
+//replaces the parents with component numbers and gathers their sizes and bounds
+void ComponentLabels::measure()
+{
+    //parents come before their children, so one forward pass resolves them
+    std::vector<Component> found;
+    for (std::size_t j = 0; j < labels_.size(); j++)
+    {
+        if (labels_[j] == j)
+        {
+            labels_[j] = (std::uint32_t)found.size();
+            found.push_back(Component());
+        }
+        else
+            labels_[j] = labels_[labels_[j]];
+    }
+
+    for (std::size_t d = 0; d < height_; d++)
+    {
+        for (std::size_t x = 0; x < size_; x++)
+        {
+            std::size_t row = d * size_ + x;
+            for (std::size_t j = rowStarts_[row]; j < rowStarts_[row + 1]; j++)
+            {
+                Component& component = found[labels_[j]];
+                if (component.voxels_ == 0)
+                {
+                    component.minD_ = d, component.minX_ = x, component.minY_ = runs_[j].start_;
+                    component.maxD_ = d + 1, component.maxX_ = x + 1, component.maxY_ = runs_[j].end_;
+                }
+
+                component.voxels_ += runs_[j].end_ - runs_[j].start_;
+                component.minX_ = std::min(component.minX_, x);
+                component.minY_ = std::min(component.minY_, (std::size_t)runs_[j].start_);
+                component.maxD_ = std::max(component.maxD_, d + 1);
+                component.maxX_ = std::max(component.maxX_, x + 1);
+                component.maxY_ = std::max(component.maxY_, (std::size_t)runs_[j].end_);
+            }
+        }
+    }
+
+    std::vector<std::uint32_t> order(found.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) {
+        return found[a].voxels_ > found[b].voxels_;
+    });
+
+    std::vector<std::uint32_t> renumber(found.size());
+    for (std::size_t j = 0; j < order.size(); j++)
+    {
+        renumber[order[j]] = (std::uint32_t)j;
+        components_.push_back(found[order[j]]);
+    }
+
+    for (auto& label : labels_)
+        label = renumber[label];
+}
@@ -0,0 +1,44 @@
+
+#ifndef COMPONENTS
+#define COMPONENTS
+
+/**
+    ComponentLabels finds the 6-connected components of a Volume. Every
+    inside run of a row is a node; the volume is cut into slabs along d that
+    are labelled by separate threads with union-find, and the slabs are then
+    joined across their boundary layers. Components are numbered from the
+    largest down. Runs are indexed with 32 bits, and a volume with more
+    runs than that throws rather than wrapping around.
+**/
+
+#include "Volume.hpp"
+#include "Run.struct"
+#include "Component.struct"
+
+class ComponentLabels
+{
+    public:
+        ComponentLabels(const Volume& volume);
+
+        const std::vector<Component>& getComponents() const;
+        std::size_t getBytes() const;
+        std::vector<std::pair<Run, std::uint32_t>> getRow(std::size_t d, std::size_t x) const;
+        std::uint32_t getComponentAt(std::size_t d, std::size_t x, std::size_t y) const;
+        void keep(Volume& volume, const std::vector<bool>& kept) const;
+
+    private:
+        void findRuns(const Volume& volume, const std::vector<std::size_t>& slabs);
+        void joinRows(std::size_t rowA, std::size_t rowB);
+        void join(std::uint32_t runA, std::uint32_t runB);
+        std::uint32_t find(std::uint32_t run);
+        void measure();
+
+    private:
+        std::size_t height_, size_;
+        std::vector<std::size_t> rowStarts_; //first run of each row, d-major
+        std::vector<Run> runs_;
+        std::vector<std::uint32_t> labels_; //union-find parents, then components
+        std::vector<Component> components_;
+};
+
+#endif
@@ -0,0 +1,209 @@
+
+#include "ConversionCache.hpp"
+#include "Greedy.hpp"
+#include "Parallel.hpp"
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+
+
+const std::uint64_t FNV_OFFSET = 14695981039346656037ull;
+const std::uint64_t FNV_PRIME = 1099511628211ull;
+
+
+#pragma pack(push, 1)
+struct CacheHeader
+{
+    char magic_[4]; //"MBC1"
+    std::uint32_t height_, size_, blockSize_, slabCount_;
+};
+#pragma pack(pop)
+
+
+
+ConversionCache::ConversionCache(std::size_t height, std::size_t size, std::size_t blockSize) :
+    height_(height), size_(size), blockSize_(blockSize),
+    slabCount_((height / blockSize + SLAB_BLOCKS - 1) / SLAB_BLOCKS), valid_(false),
+    sliceHashes_(height, 0), volume_(height, size),
+    slabHashes_(slabCount_, 0), slabBoxes_(slabCount_), regrown_(0)
+{}
+
+
+
+//loads the cache, returning false and staying empty unless it fits this volume
+bool ConversionCache::read(const std::string& filename)
+{
+    std::ifstream fin;
+    fin.open(filename, std::ifstream::in | std::ifstream::binary);
+    if (fin.fail())
+        return false;
+
+    CacheHeader header;
+    fin.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!fin || std::memcmp(header.magic_, "MBC1", 4) != 0 || header.height_ != height_ ||
+        header.size_ != size_ || header.blockSize_ != blockSize_ || header.slabCount_ != slabCount_)
+        return false;
+
+    fin.read(reinterpret_cast<char*>(sliceHashes_.data()), (std::streamsize)(height_ * sizeof(std::uint64_t)));
+
+    std::vector<Volume::Word> layer(size_ * volume_.getRowWords());
+    for (std::size_t d = 0; d < height_ && fin; d++)
+    {
+        fin.read(reinterpret_cast<char*>(layer.data()), (std::streamsize)(layer.size() * sizeof(Volume::Word)));
+        for (std::size_t x = 0; x < size_; x++)
+            for (std::size_t w = 0; w < volume_.getRowWords(); w++)
+                volume_.getWord(d, x, w) = layer[x * volume_.getRowWords() + w];
+    }
+
+    for (std::size_t slab = 0; slab < slabCount_ && fin; slab++)
+    {
+        std::uint32_t boxCount = 0;
+        fin.read(reinterpret_cast<char*>(&slabHashes_[slab]), sizeof(std::uint64_t));
+        fin.read(reinterpret_cast<char*>(&boxCount), sizeof(boxCount));
+        std::vector<BoxRecord> records(fin ? boxCount : 0);
+        fin.read(reinterpret_cast<char*>(records.data()), (std::streamsize)(records.size() * sizeof(BoxRecord)));
+
+        slabBoxes_[slab].clear();
+        for (const auto& record : records)
+            slabBoxes_[slab].push_back(std::make_pair(Point3D(record.d0_, record.x0_, record.y0_),
+                Point3D(record.d1_, record.x1_, record.y1_)));
+    }
+
+    valid_ = !fin.fail();
+    if (!valid_) //a truncated cache is as good as none
+        *this = ConversionCache(height_, size_, blockSize_);
+    return valid_;
+}
+
+
+
+bool ConversionCache::write(const std::string& filename) const
+{
+    CacheHeader header;
+    std::memcpy(header.magic_, "MBC1", 4);
+    header.height_ = (std::uint32_t)height_;
+    header.size_ = (std::uint32_t)size_;
+    header.blockSize_ = (std::uint32_t)blockSize_;
+    header.slabCount_ = (std::uint32_t)slabCount_;
+
+    std::ofstream fout;
+    fout.open(filename, std::ofstream::out | std::ofstream::binary);
+    fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    fout.write(reinterpret_cast<const char*>(sliceHashes_.data()), (std::streamsize)(height_ * sizeof(std::uint64_t)));
+
+    std::vector<Volume::Word> layer(size_ * volume_.getRowWords());
+    for (std::size_t d = 0; d < height_; d++)
+    {
+        for (std::size_t x = 0; x < size_; x++)
+            for (std::size_t w = 0; w < volume_.getRowWords(); w++)
+                layer[x * volume_.getRowWords() + w] = volume_.getWord(d, x, w);
+        fout.write(reinterpret_cast<const char*>(layer.data()), (std::streamsize)(layer.size() * sizeof(Volume::Word)));
+    }
+
+    for (std::size_t slab = 0; slab < slabCount_; slab++)
+    {
+        std::vector<BoxRecord> records;
+        for (const auto& box : slabBoxes_[slab])
+            records.push_back(BoxRecord{
+                (std::int16_t)box.first.d_, (std::int16_t)box.first.x_, (std::int16_t)box.first.y_,
+                (std::int16_t)box.second.d_, (std::int16_t)box.second.x_, (std::int16_t)box.second.y_});
+
+        auto boxCount = (std::uint32_t)records.size();
+        fout.write(reinterpret_cast<const char*>(&slabHashes_[slab]), sizeof(std::uint64_t));
+        fout.write(reinterpret_cast<const char*>(&boxCount), sizeof(boxCount));
+        fout.write(reinterpret_cast<const char*>(records.data()), (std::streamsize)(records.size() * sizeof(BoxRecord)));
+    }
+
+    fout.close();
+    return !fout.fail();
+}
+
+
+
+//returns the layers whose slice hash differs from the cached one, or all of them without a cache
+std::vector<std::size_t> ConversionCache::findChangedSlices(const std::vector<std::uint64_t>& hashes) const
+{
+    std::vector<std::size_t> changed;
+    for (std::size_t d = 0; d < height_; d++)
+        if (!valid_ || hashes[d] != sliceHashes_[d])
+            changed.push_back(d);
+    return changed;
+}
+
+
+
+void ConversionCache::setSliceHashes(const std::vector<std::uint64_t>& hashes)
+{
+    sliceHashes_ = hashes;
+}
+
+
+
+//the volume as read, before islands are removed
+Volume& ConversionCache::getVolume()
+{
+    return volume_;
+}
+
+
+
+//grows the cuboids of every slab whose cleaned voxels changed, reusing the others
+std::vector<Bounds2D> ConversionCache::findCuboids(const Volume& cleaned)
+{
+    Volume blocks = findFullBlocks(cleaned, blockSize_);
+    std::size_t slabLayers = SLAB_BLOCKS * blockSize_;
+
+    std::vector<std::size_t> dirty;
+    std::vector<std::uint64_t> hashes(slabCount_);
+    runInParallel(slabCount_, [&](std::size_t slab) {
+        hashes[slab] = hashLayers(cleaned, slab * slabLayers, std::min((slab + 1) * slabLayers, height_));
+    });
+    for (std::size_t slab = 0; slab < slabCount_; slab++)
+        if (!valid_ || hashes[slab] != slabHashes_[slab])
+            dirty.push_back(slab);
+
+    runInParallel(dirty.size(), [&](std::size_t j) {
+        std::size_t slab = dirty[j];
+        slabHashes_[slab] = hashes[slab];
+        slabBoxes_[slab].clear();
+        growCuboids(blocks, slab * SLAB_BLOCKS, std::min((slab + 1) * SLAB_BLOCKS, blocks.getHeight()),
+            blockSize_, slabBoxes_[slab]);
+    });
+    regrown_ = dirty.size();
+
+    std::vector<Bounds2D> boxes;
+    for (const auto& slab : slabBoxes_)
+        boxes.insert(boxes.end(), slab.begin(), slab.end());
+    return boxes;
+}
+
+
+
+std::size_t ConversionCache::getRegrownSlabs() const
+{
+    return regrown_;
+}
+
+
+
+//64-bit FNV-1a
+std::uint64_t hashBytes(const char* bytes, std::size_t length)
+{
+    std::uint64_t hash = FNV_OFFSET;
+    for (std::size_t j = 0; j < length; j++)
+        hash = (hash ^ (unsigned char)bytes[j]) * FNV_PRIME;
+    return hash;
+}
+
+
+
+//FNV-1a over whole words instead of bytes, which is plenty to notice a change
+std::uint64_t hashLayers(const Volume& volume, std::size_t minD, std::size_t maxD)
+{
+    std::uint64_t hash = FNV_OFFSET;
+    for (std::size_t d = minD; d < maxD; d++)
+        for (std::size_t x = 0; x < volume.getSize(); x++)
+            for (std::size_t w = 0; w < volume.getRowWords(); w++)
+                hash = (hash ^ volume.getWord(d, x, w)) * FNV_PRIME;
+    return hash;
+}
@@ -0,0 +1,52 @@
+#ifndef CONVERSION_CACHE
+#define CONVERSION_CACHE
+
+/**
+    A ConversionCache remembers enough of the last run for the next one to
+    redo only what has changed. It keeps a content hash for each slice,
+    the volume as it was read, and, for each slab of cuboids, a hash of the
+    slab's voxels once the islands are gone together with the boxes grown
+    from them.
+
+    On a rerun only the slices whose hash changed are parsed, on top of the
+    cached volume. Connectivity is labelled again over the whole volume,
+    since a change anywhere can join or split components, but only the
+    slabs whose cleaned voxels differ from last time grow their boxes
+    again. Cuboids never cross a slab, so the patched box list is the one a
+    full run would give.
+**/
+
+#include "main.hpp"
+#include "Volume.hpp"
+#include <vector>
+#include <string>
+#include <cstdint>
+
+class ConversionCache
+{
+    public:
+        ConversionCache(std::size_t height, std::size_t size, std::size_t blockSize);
+
+        bool read(const std::string& filename);
+        bool write(const std::string& filename) const;
+
+        std::vector<std::size_t> findChangedSlices(const std::vector<std::uint64_t>& hashes) const;
+        void setSliceHashes(const std::vector<std::uint64_t>& hashes);
+        Volume& getVolume();
+        std::vector<Bounds2D> findCuboids(const Volume& cleaned);
+        std::size_t getRegrownSlabs() const;
+
+    private:
+        std::size_t height_, size_, blockSize_, slabCount_;
+        bool valid_; //false until a matching cache was read
+        std::vector<std::uint64_t> sliceHashes_;
+        Volume volume_;
+        std::vector<std::uint64_t> slabHashes_; //of the cleaned voxels
+        std::vector<std::vector<Bounds2D>> slabBoxes_;
+        std::size_t regrown_;
+};
+
+std::uint64_t hashBytes(const char* bytes, std::size_t length);
+std::uint64_t hashLayers(const Volume& volume, std::size_t minD, std::size_t maxD);
+
+#endif
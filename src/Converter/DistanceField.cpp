@@ -0,0 +1,225 @@
+
+#include "DistanceField.hpp"
+#include "Parallel.hpp"
+#include <fstream>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+
+const float FAR = 1e20f; //squared distance from voxels with no feature in range
+const std::int8_t MAX_VALUE = 127; //stands for the band
+
+
+#pragma pack(push, 1)
+struct DistanceHeader
+{
+    char magic_[4]; //"MBS1"
+    std::uint32_t height_, size_, brickSize_, band_;
+};
+#pragma pack(pop)
+
+
+
+DistanceField::DistanceField(const Volume& volume, std::size_t band) :
+    height_(volume.getHeight()), size_(volume.getSize()), band_(band),
+    bricksD_((height_ + BRICK_SIZE - 1) / BRICK_SIZE), bricksX_((size_ + BRICK_SIZE - 1) / BRICK_SIZE),
+    uniform_(bricksD_ * bricksX_ * bricksX_, 0), values_(uniform_.size())
+{
+    runInParallel(uniform_.size(), [&](std::size_t brick) {
+        transformBrick(volume, brick);
+    });
+}
+
+
+
+void DistanceField::write(const std::string& filename) const
+{
+    DistanceHeader header;
+    std::memcpy(header.magic_, "MBS1", 4);
+    header.height_ = (std::uint32_t)height_;
+    header.size_ = (std::uint32_t)size_;
+    header.brickSize_ = (std::uint32_t)BRICK_SIZE;
+    header.band_ = (std::uint32_t)band_;
+
+    std::ofstream fout;
+    fout.open(filename, std::ofstream::out | std::ofstream::binary);
+    fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    fout.write(reinterpret_cast<const char*>(uniform_.data()), (std::streamsize)uniform_.size());
+    for (const auto& values : values_)
+        fout.write(reinterpret_cast<const char*>(values.data()), (std::streamsize)values.size());
+
+    fout.close();
+}
+
+
+
+std::size_t DistanceField::getStoredBricks() const
+{
+    return (std::size_t)std::count(uniform_.begin(), uniform_.end(), 0);
+}
+
+
+
+//fills in one brick, from the distance transforms of the brick grown by the band
+void DistanceField::transformBrick(const Volume& volume, std::size_t brick)
+{
+    const std::size_t bY = brick % bricksX_, bX = brick / bricksX_ % bricksX_, bD = brick / bricksX_ / bricksX_;
+    const std::size_t minD = bD * BRICK_SIZE, minX = bX * BRICK_SIZE, minY = bY * BRICK_SIZE;
+    if (isUniform(volume, minD, minX, minY, false))
+    {
+        uniform_[brick] = MAX_VALUE;
+        return;
+    }
+    if (isUniform(volume, minD, minX, minY, true))
+    {
+        uniform_[brick] = -MAX_VALUE;
+        return;
+    }
+
+    //the region starts band_ before the brick on every axis, and is outside beyond the volume
+    const std::size_t n = BRICK_SIZE + 2 * band_;
+    std::vector<float> toInside(n * n * n), toOutside(n * n * n);
+    for (std::size_t d = 0; d < n; d++)
+    {
+        for (std::size_t x = 0; x < n; x++)
+        {
+            for (std::size_t y = 0; y < n; y++)
+            {
+                std::size_t vD = minD + d - band_, vX = minX + x - band_, vY = minY + y - band_;
+                bool inside = vD < height_ && vX < size_ && vY < size_ && volume.get(vD, vX, vY);
+                std::size_t index = (d * n + x) * n + y;
+                toInside[index] = inside ? 0 : FAR;
+                toOutside[index] = inside ? FAR : 0;
+            }
+        }
+    }
+
+    //only the lines that reach the brick are needed by the passes after the first
+    std::vector<float> values;
+    std::vector<std::size_t> vertices;
+    std::vector<float> bounds;
+    for (auto grid : { &toInside, &toOutside })
+    {
+        float* cells = grid->data();
+        for (std::size_t d = 0; d < n; d++)
+            for (std::size_t x = 0; x < n; x++)
+                transformLine(cells + (d * n + x) * n, n, 1, values, vertices, bounds);
+
+        for (std::size_t d = 0; d < n; d++)
+            for (std::size_t y = band_; y < band_ + BRICK_SIZE; y++)
+                transformLine(cells + d * n * n + y, n, n, values, vertices, bounds);
+
+        for (std::size_t x = band_; x < band_ + BRICK_SIZE; x++)
+            for (std::size_t y = band_; y < band_ + BRICK_SIZE; y++)
+                transformLine(cells + x * n + y, n, n * n, values, vertices, bounds);
+    }
+
+    std::vector<std::int8_t>& brickValues = values_[brick];
+    brickValues.resize(BRICK_SIZE * BRICK_SIZE * BRICK_SIZE);
+    const float scale = (float)MAX_VALUE / (float)band_;
+    for (std::size_t d = 0; d < BRICK_SIZE; d++)
+    {
+        for (std::size_t x = 0; x < BRICK_SIZE; x++)
+        {
+            for (std::size_t y = 0; y < BRICK_SIZE; y++)
+            {
+                std::size_t index = ((d + band_) * n + x + band_) * n + y + band_;
+                float distance = toInside[index] < 1 ? 0.5f - std::sqrt(toOutside[index]) :
+                    std::sqrt(toInside[index]) - 0.5f;
+                float value = std::max(std::min(std::round(distance * scale), (float)MAX_VALUE), -(float)MAX_VALUE);
+                brickValues[(d * BRICK_SIZE + x) * BRICK_SIZE + y] = (std::int8_t)value;
+            }
+        }
+    }
+
+    //surface in the halo may still be farther than the band from the whole brick
+    if (std::all_of(brickValues.begin(), brickValues.end(), [&](std::int8_t v) { return v == brickValues[0]; }))
+    {
+        uniform_[brick] = brickValues[0];
+        brickValues = std::vector<std::int8_t>();
+    }
+}
+
+
+
+//whether every voxel of the brick grown by the band is inside, or every one outside
+bool DistanceField::isUniform(const Volume& volume, std::size_t minD, std::size_t minX,
+    std::size_t minY, bool inside) const
+{
+    const std::size_t n = BRICK_SIZE + 2 * band_;
+    std::size_t fromY = minY >= band_ ? minY - band_ : 0, toY = std::min(minY + BRICK_SIZE + band_, size_);
+    bool clipped = minY < band_ || minY + BRICK_SIZE + band_ > size_;
+
+    for (std::size_t d = minD - band_; d != minD - band_ + n; d++)
+    {
+        for (std::size_t x = minX - band_; x != minX - band_ + n; x++)
+        {
+            bool pastEdge = d >= height_ || x >= size_; //which is outside
+            if (inside && (pastEdge || clipped))
+                return false;
+            if (pastEdge)
+                continue;
+
+            for (std::size_t y = fromY; y < toY; )
+            {
+                std::size_t low = y % Volume::WORD_BITS, high = std::min(Volume::WORD_BITS, low + toY - y);
+                Volume::Word mask = high - low == Volume::WORD_BITS ? ~(Volume::Word)0 :
+                    (((Volume::Word)1 << (high - low)) - 1) << low;
+                Volume::Word word = volume.getWord(d, x, y / Volume::WORD_BITS) & mask;
+                if (inside ? word != mask : word != 0)
+                    return false;
+                y += high - low;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+
+/*
+    Felzenszwalb and Huttenlocher's exact 1D distance transform of squared
+    distances, in place along a strided line: each value becomes the least
+    of every other value plus its squared distance, found from the lower
+    envelope of the parabolas rooted at each sample.
+*/
+void transformLine(float* line, std::size_t length, std::size_t stride,
+    std::vector<float>& values, std::vector<std::size_t>& vertices, std::vector<float>& bounds)
+{
+    values.resize(length);
+    vertices.resize(length);
+    bounds.resize(length + 1);
+    for (std::size_t q = 0; q < length; q++)
+        values[q] = line[q * stride];
+
+    auto intersect = [&](std::size_t q, std::size_t p) {
+        return ((values[q] + (float)(q * q)) - (values[p] + (float)(p * p))) / (float)(2 * q - 2 * p);
+    };
+
+    std::size_t k = 0;
+    vertices[0] = 0;
+    bounds[0] = -FAR;
+    bounds[1] = FAR;
+    for (std::size_t q = 1; q < length; q++)
+    {
+        float s = intersect(q, vertices[k]);
+        while (s <= bounds[k])
+            s = intersect(q, vertices[--k]);
+
+        k++;
+        vertices[k] = q;
+        bounds[k] = s;
+        bounds[k + 1] = FAR;
+    }
+
+    k = 0;
+    for (std::size_t q = 0; q < length; q++)
+    {
+        while (bounds[k + 1] < (float)q)
+            k++;
+        float offset = (float)q - (float)vertices[k];
+        line[q * stride] = offset * offset + values[vertices[k]];
+    }
+}
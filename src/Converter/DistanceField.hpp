@@ -0,0 +1,57 @@
+#ifndef DISTANCE_FIELD
+#define DISTANCE_FIELD
+
+/**
+    A DistanceField holds the signed distance from every voxel of a Volume
+    to its surface, positive outside and negative inside, truncated to a
+    band of a few voxels around the surface. Distances are measured
+    between voxel centers, less half a voxel, so the surface lies where
+    the sign changes.
+
+    The volume is handled in cubic bricks, each on its own thread. A brick
+    is extended by the band on every side, and Felzenszwalb's exact
+    Euclidean distance transform runs over the extended region, one axis
+    after another: once to the nearest inside voxel and once to the
+    nearest outside voxel. Any voxel within the band of one in the brick
+    lies in the region, so every distance up to the band is exact, and
+    only those are kept. Bricks whose region is all inside or all outside
+    are not transformed at all.
+
+    The file starts with "MBS1" and the height, size, brick size and band
+    as 32-bit integers. A byte per brick follows, numbered d-major, which is
+    the brick's value if all its voxels share it and 0 otherwise. The
+    bricks with a 0 there come last, in the same order, each as brick
+    size cubed bytes in d, x, y order. A byte is the distance scaled so
+    that 127 is the band; beyond it, distances are 127 or -127.
+**/
+
+#include "Volume.hpp"
+#include <vector>
+#include <string>
+#include <cstdint>
+
+class DistanceField
+{
+    public:
+        static const std::size_t BRICK_SIZE = 32;
+
+        DistanceField(const Volume& volume, std::size_t band);
+
+        void write(const std::string& filename) const;
+        std::size_t getStoredBricks() const;
+
+    private:
+        void transformBrick(const Volume& volume, std::size_t brick);
+        bool isUniform(const Volume& volume, std::size_t d, std::size_t x, std::size_t y, bool inside) const;
+
+    private:
+        std::size_t height_, size_, band_;
+        std::size_t bricksD_, bricksX_; //along d, and along x and y alike
+        std::vector<std::int8_t> uniform_; //value of each brick, 0 if it varies
+        std::vector<std::vector<std::int8_t>> values_; //of the varying bricks
+};
+
+void transformLine(float* line, std::size_t length, std::size_t stride,
+    std::vector<float>& values, std::vector<std::size_t>& vertices, std::vector<float>& bounds);
+
+#endif
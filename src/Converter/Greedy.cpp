@@ -0,0 +1,151 @@
+
+#include "Greedy.hpp"
+#include "Parallel.hpp"
+#include <algorithm>
+
+
+//blockSize must be a power of two no larger than a word
+std::vector<Bounds2D> findCuboids(const Volume& volume, std::size_t blockSize)
+{
+    Volume blocks = findFullBlocks(volume, blockSize);
+
+    std::size_t slabCount = (blocks.getHeight() + SLAB_BLOCKS - 1) / SLAB_BLOCKS;
+    std::vector<std::vector<Bounds2D>> slabBoxes(slabCount);
+    runInParallel(slabCount, [&](std::size_t slab) {
+        growCuboids(blocks, slab * SLAB_BLOCKS, std::min((slab + 1) * SLAB_BLOCKS, blocks.getHeight()),
+            blockSize, slabBoxes[slab]);
+    });
+
+    std::vector<Bounds2D> boxes;
+    for (const auto& slab : slabBoxes)
+        boxes.insert(boxes.end(), slab.begin(), slab.end());
+    return boxes;
+}
+
+
+
+//returns a volume with one voxel per aligned block, set if the whole block is inside
+Volume findFullBlocks(const Volume& volume, std::size_t blockSize)
+{
+    Volume blocks(volume.getHeight() / blockSize, volume.getSize() / blockSize);
+    Volume::Word mask = blockSize == Volume::WORD_BITS ? ~(Volume::Word)0 : ((Volume::Word)1 << blockSize) - 1;
+
+    std::vector<std::size_t> slabs = splitEvenly(blocks.getHeight(), std::max(std::min(getThreadCount(), blocks.getHeight()), (std::size_t)1));
+    runInParallel(slabs.size() - 1, [&](std::size_t slab) {
+        for (std::size_t bD = slabs[slab]; bD < slabs[slab + 1]; bD++)
+        {
+            for (std::size_t bX = 0; bX < blocks.getSize(); bX++)
+            {
+                for (std::size_t bY = 0; bY < blocks.getSize(); bY++)
+                {
+                    std::size_t y = bY * blockSize;
+                    Volume::Word all = mask;
+                    for (std::size_t d = bD * blockSize; d < (bD + 1) * blockSize && all == mask; d++)
+                        for (std::size_t x = bX * blockSize; x < (bX + 1) * blockSize; x++)
+                            all &= volume.getWord(d, x, y / Volume::WORD_BITS) >> (y % Volume::WORD_BITS);
+
+                    if ((all & mask) == mask)
+                        blocks.set(bD, bX, bY);
+                }
+            }
+        }
+    });
+
+    return blocks;
+}
+
+
+
+//covers the blocks of layers [minD, maxD) with boxes, clearing them as it goes
+void growCuboids(Volume& blocks, std::size_t minD, std::size_t maxD,
+    std::size_t blockSize, std::vector<Bounds2D>& boxes)
+{
+    for (std::size_t d = minD; d < maxD; d++)
+    {
+        for (std::size_t x = 0; x < blocks.getSize(); x++)
+        {
+            for (std::size_t w = 0; w < blocks.getRowWords(); w++)
+            {
+                while (blocks.getWord(d, x, w) != 0)
+                {
+                    std::size_t y = w * Volume::WORD_BITS + (std::size_t)__builtin_ctzll(blocks.getWord(d, x, w));
+                    std::size_t endY = findRunEnd(blocks, d, x, y);
+
+                    std::size_t endX = x + 1;
+                    while (endX < blocks.getSize() && isRunFree(blocks, d, endX, y, endY))
+                        endX++;
+
+                    std::size_t endD = d + 1;
+                    bool layerFree = true;
+                    while (endD < maxD && layerFree)
+                    {
+                        for (std::size_t r = x; r < endX && layerFree; r++)
+                            layerFree = isRunFree(blocks, endD, r, y, endY);
+                        if (layerFree)
+                            endD++;
+                    }
+
+                    for (std::size_t q = d; q < endD; q++)
+                        for (std::size_t r = x; r < endX; r++)
+                            clearRun(blocks, q, r, y, endY);
+
+                    boxes.push_back(std::make_pair(
+                        Point3D((int)(d * blockSize), (int)(x * blockSize), (int)(y * blockSize)),
+                        Point3D((int)(endD * blockSize), (int)(endX * blockSize), (int)(endY * blockSize))));
+                }
+            }
+        }
+    }
+}
+
+
+
+//returns the first y at or after the given one that is not set
+std::size_t findRunEnd(const Volume& blocks, std::size_t d, std::size_t x, std::size_t y)
+{
+    std::size_t w = y / Volume::WORD_BITS;
+    Volume::Word gaps = ~blocks.getWord(d, x, w) >> (y % Volume::WORD_BITS);
+    if (gaps != 0)
+        return y + (std::size_t)__builtin_ctzll(gaps);
+
+    for (w++; w < blocks.getRowWords(); w++)
+    {
+        gaps = ~blocks.getWord(d, x, w);
+        if (gaps != 0)
+            return std::min(w * Volume::WORD_BITS + (std::size_t)__builtin_ctzll(gaps), blocks.getSize());
+    }
+
+    return blocks.getSize();
+}
+
+
+
+//true if every block in [y, end) of the row is set
+bool isRunFree(const Volume& blocks, std::size_t d, std::size_t x, std::size_t y, std::size_t end)
+{
+    for (std::size_t w = y / Volume::WORD_BITS; w * Volume::WORD_BITS < end; w++)
+    {
+        std::size_t from = std::max(y, w * Volume::WORD_BITS) - w * Volume::WORD_BITS;
+        std::size_t to = std::min(end, (w + 1) * Volume::WORD_BITS) - w * Volume::WORD_BITS;
+        Volume::Word mask = (to == Volume::WORD_BITS ? ~(Volume::Word)0 : ((Volume::Word)1 << to) - 1) &
+            ~(((Volume::Word)1 << from) - 1);
+        if ((blocks.getWord(d, x, w) & mask) != mask)
+            return false;
+    }
+
+    return true;
+}
+
+
+
+void clearRun(Volume& blocks, std::size_t d, std::size_t x, std::size_t y, std::size_t end)
+{
+    for (std::size_t w = y / Volume::WORD_BITS; w * Volume::WORD_BITS < end; w++)
+    {
+        std::size_t from = std::max(y, w * Volume::WORD_BITS) - w * Volume::WORD_BITS;
+        std::size_t to = std::min(end, (w + 1) * Volume::WORD_BITS) - w * Volume::WORD_BITS;
+        Volume::Word mask = (to == Volume::WORD_BITS ? ~(Volume::Word)0 : ((Volume::Word)1 << to) - 1) &
+            ~(((Volume::Word)1 << from) - 1);
+        blocks.getWord(d, x, w) &= ~mask;
+    }
+}
@@ -0,0 +1,26 @@
+
+#ifndef GREEDY
+#define GREEDY
+
+/**
+    Greedy meshing covers the same voxels as the full octree nodes, but
+    with maximal cuboids instead of aligned cubes. The volume is first
+    reduced to a grid of blocks that are entirely inside, then each slab of
+    that grid grows boxes from its first uncovered block: along y, then x,
+    then d, as far as every block in the way is still uncovered.
+**/
+
+#include "main.hpp"
+#include "Volume.hpp"
+
+const std::size_t SLAB_BLOCKS = 32; //boxes never cross slabs, keeping output independent of threads
+
+std::vector<Bounds2D> findCuboids(const Volume& volume, std::size_t blockSize);
+Volume findFullBlocks(const Volume& volume, std::size_t blockSize);
+void growCuboids(Volume& blocks, std::size_t minD, std::size_t maxD,
+    std::size_t blockSize, std::vector<Bounds2D>& boxes);
+std::size_t findRunEnd(const Volume& blocks, std::size_t d, std::size_t x, std::size_t y);
+bool isRunFree(const Volume& blocks, std::size_t d, std::size_t x, std::size_t y, std::size_t end);
+void clearRun(Volume& blocks, std::size_t d, std::size_t x, std::size_t y, std::size_t end);
+
+#endif
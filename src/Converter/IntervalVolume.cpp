@@ -0,0 +1,359 @@
+
+#include "IntervalVolume.hpp"
+#include "Greedy.hpp"
+#include "Parallel.hpp"
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+
+const std::uint32_t UNLABELLED = ~(std::uint32_t)0;
+
+
+IntervalVolume::IntervalVolume(std::size_t height, std::size_t size, const std::vector<Row>& rows) :
+    height_(height), size_(size), rowStarts_(height * size + 1, 0)
+{
+    for (std::size_t j = 0; j < rows.size(); j++)
+        rowStarts_[j + 1] = rowStarts_[j] + rows[j].size();
+    if (rowStarts_.back() > UNLABELLED) //every run could be a component of its own
+        throw std::runtime_error("The volume has " + std::to_string(rowStarts_.back()) +
+            " runs, more than the " + std::to_string(UNLABELLED) + " that can be labelled!");
+
+    runs_.reserve(rowStarts_.back());
+    for (const auto& row : rows)
+        runs_.insert(runs_.end(), row.begin(), row.end());
+}
+
+
+
+std::size_t IntervalVolume::getHeight() const
+{
+    return height_;
+}
+
+
+
+std::size_t IntervalVolume::getSize() const
+{
+    return size_;
+}
+
+
+
+std::size_t IntervalVolume::getRunCount() const
+{
+    return runs_.size();
+}
+
+
+
+std::size_t IntervalVolume::count() const
+{
+    std::size_t voxels = 0;
+    for (const auto& run : runs_)
+        voxels += run.end_ - run.start_;
+    return voxels;
+}
+
+
+
+//labels every run by flood filling from the first unlabelled one, largest component first
+const std::vector<Component>& IntervalVolume::findComponents()
+{
+    labels_.assign(runs_.size(), UNLABELLED);
+    std::vector<Component> found;
+    for (std::size_t d = 0; d < height_; d++)
+    {
+        for (std::size_t x = 0; x < size_; x++)
+        {
+            std::size_t row = d * size_ + x;
+            for (std::size_t j = rowStarts_[row]; j < rowStarts_[row + 1]; j++)
+            {
+                if (labels_[j] != UNLABELLED)
+                    continue;
+
+                labels_[j] = (std::uint32_t)found.size();
+                found.push_back(Component());
+                floodFill(j, d, x, found.back());
+            }
+        }
+    }
+
+    std::vector<std::uint32_t> order(found.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) {
+        return found[a].voxels_ > found[b].voxels_;
+    });
+
+    std::vector<std::uint32_t> renumber(found.size());
+    components_.clear();
+    for (std::size_t j = 0; j < order.size(); j++)
+    {
+        renumber[order[j]] = (std::uint32_t)j;
+        components_.push_back(found[order[j]]);
+    }
+
+    for (auto& label : labels_)
+        label = renumber[label];
+    return components_;
+}
+
+
+
+//drops the runs of every component not marked as kept
+void IntervalVolume::keep(const std::vector<bool>& kept)
+{
+    std::size_t next = 0;
+    for (std::size_t row = 0; row + 1 < rowStarts_.size(); row++)
+    {
+        std::size_t start = next;
+        for (std::size_t j = rowStarts_[row]; j < rowStarts_[row + 1]; j++)
+        {
+            if (kept[labels_[j]])
+            {
+                runs_[next] = runs_[j];
+                labels_[next++] = labels_[j];
+            }
+        }
+        rowStarts_[row] = start;
+    }
+
+    rowStarts_.back() = next;
+    runs_.resize(next);
+    labels_.resize(next);
+}
+
+
+
+//covers the full aligned blocks with the same boxes as greedy meshing
+std::vector<Bounds2D> IntervalVolume::findCuboids(std::size_t blockSize) const
+{
+    std::vector<Row> blocks = findFullBlocks(blockSize);
+    std::size_t blocksHigh = height_ / blockSize, blocksPerSide = size_ / blockSize;
+
+    std::size_t slabCount = (blocksHigh + SLAB_BLOCKS - 1) / SLAB_BLOCKS;
+    std::vector<std::vector<Bounds2D>> slabBoxes(slabCount);
+    runInParallel(slabCount, [&](std::size_t slab) {
+        growRunCuboids(blocks, blocksPerSide, slab * SLAB_BLOCKS, std::min((slab + 1) * SLAB_BLOCKS, blocksHigh),
+            blockSize, slabBoxes[slab]);
+    });
+
+    std::vector<Bounds2D> boxes;
+    for (const auto& slab : slabBoxes)
+        boxes.insert(boxes.end(), slab.begin(), slab.end());
+    return boxes;
+}
+
+
+
+//labels every run connected to the given one, which must already carry its label
+void IntervalVolume::floodFill(std::size_t run, std::size_t d, std::size_t x, Component& component)
+{
+    const std::uint32_t label = labels_[run];
+    component.minD_ = component.maxD_ = d;
+    component.minX_ = component.maxX_ = x;
+    component.minY_ = runs_[run].start_;
+    component.maxY_ = runs_[run].end_;
+
+    struct Pending
+    {
+        std::size_t run, d, x;
+    };
+
+    std::vector<Pending> pending(1, Pending{run, d, x});
+    while (!pending.empty())
+    {
+        Pending current = pending.back();
+        pending.pop_back();
+
+        const Run& reached = runs_[current.run];
+        component.voxels_ += reached.end_ - reached.start_;
+        component.minD_ = std::min(component.minD_, current.d);
+        component.minX_ = std::min(component.minX_, current.x);
+        component.minY_ = std::min(component.minY_, (std::size_t)reached.start_);
+        component.maxD_ = std::max(component.maxD_, current.d);
+        component.maxX_ = std::max(component.maxX_, current.x);
+        component.maxY_ = std::max(component.maxY_, (std::size_t)reached.end_);
+
+        const int steps[4][2] = { {-1, 0}, {1, 0}, {0, -1}, {0, 1} };
+        for (const auto& step : steps)
+        {
+            std::size_t nD = current.d + (std::size_t)step[0], nX = current.x + (std::size_t)step[1];
+            if (nD >= height_ || nX >= size_) //also catches -1, which wraps around
+                continue;
+
+            std::size_t row = nD * size_ + nX;
+            auto end = runs_.begin() + (std::ptrdiff_t)rowStarts_[row + 1];
+            auto neighbor = std::upper_bound(runs_.begin() + (std::ptrdiff_t)rowStarts_[row], end,
+                reached.start_, [](std::uint32_t value, const Run& r) {
+                    return value < r.end_;
+                });
+
+            for (; neighbor != end && neighbor->start_ < reached.end_; ++neighbor)
+            {
+                auto index = (std::size_t)(neighbor - runs_.begin());
+                if (labels_[index] == UNLABELLED)
+                {
+                    labels_[index] = label;
+                    pending.push_back(Pending{index, nD, nX});
+                }
+            }
+        }
+    }
+
+    component.maxD_++, component.maxX_++; //exclusive, like maxY_
+}
+
+
+
+//returns the runs of aligned blocks that are entirely inside, in blocks
+std::vector<IntervalVolume::Row> IntervalVolume::findFullBlocks(std::size_t blockSize) const
+{
+    std::size_t blocksHigh = height_ / blockSize, blocksPerSide = size_ / blockSize;
+    std::vector<Row> blocks(blocksHigh * blocksPerSide);
+
+    std::vector<std::size_t> slabs = splitEvenly(blocksHigh, std::max(std::min(getThreadCount(), blocksHigh), (std::size_t)1));
+    runInParallel(slabs.size() - 1, [&](std::size_t slab) {
+        for (std::size_t bD = slabs[slab]; bD < slabs[slab + 1]; bD++)
+        {
+            for (std::size_t bX = 0; bX < blocksPerSide; bX++)
+            {
+                Row full;
+                for (std::size_t d = bD * blockSize; d < (bD + 1) * blockSize; d++)
+                {
+                    for (std::size_t x = bX * blockSize; x < (bX + 1) * blockSize; x++)
+                    {
+                        std::size_t row = d * size_ + x;
+                        Row runs(runs_.begin() + (std::ptrdiff_t)rowStarts_[row],
+                            runs_.begin() + (std::ptrdiff_t)rowStarts_[row + 1]);
+                        full = d == bD * blockSize && x == bX * blockSize ? runs : intersectRows(full, runs);
+                    }
+                }
+
+                //shrink to the blocks that lie entirely within a run
+                Row& row = blocks[bD * blocksPerSide + bX];
+                for (const auto& run : full)
+                {
+                    auto start = (std::uint32_t)((run.start_ + blockSize - 1) / blockSize);
+                    auto end = (std::uint32_t)(run.end_ / blockSize);
+                    if (start < end)
+                        row.push_back(Run(start, end));
+                }
+            }
+        }
+    });
+
+    return blocks;
+}
+
+
+
+//returns the voxels inside either row
+IntervalVolume::Row uniteRows(const IntervalVolume::Row& a, const IntervalVolume::Row& b)
+{
+    IntervalVolume::Row united;
+    std::size_t j = 0, k = 0;
+    while (j < a.size() || k < b.size())
+    {
+        const Run& next = k == b.size() || (j < a.size() && a[j].start_ < b[k].start_) ? a[j++] : b[k++];
+        if (!united.empty() && next.start_ <= united.back().end_)
+            united.back().end_ = std::max(united.back().end_, next.end_);
+        else
+            united.push_back(next);
+    }
+
+    return united;
+}
+
+
+
+//returns the voxels inside both rows
+IntervalVolume::Row intersectRows(const IntervalVolume::Row& a, const IntervalVolume::Row& b)
+{
+    IntervalVolume::Row common;
+    std::size_t j = 0, k = 0;
+    while (j < a.size() && k < b.size())
+    {
+        std::uint32_t start = std::max(a[j].start_, b[k].start_);
+        std::uint32_t end = std::min(a[j].end_, b[k].end_);
+        if (start < end)
+            common.push_back(Run(start, end));
+
+        if (a[j].end_ < b[k].end_)
+            j++;
+        else
+            k++;
+    }
+
+    return common;
+}
+
+
+
+//true if a single run of the row covers [start, end)
+bool containsRun(const IntervalVolume::Row& row, std::uint32_t start, std::uint32_t end)
+{
+    auto run = std::upper_bound(row.begin(), row.end(), start, [](std::uint32_t value, const Run& r) {
+        return value < r.end_;
+    });
+    return run != row.end() && run->start_ <= start && end <= run->end_;
+}
+
+
+
+//cuts [start, end) out of the run covering it
+void removeRun(IntervalVolume::Row& row, std::uint32_t start, std::uint32_t end)
+{
+    auto run = std::upper_bound(row.begin(), row.end(), start, [](std::uint32_t value, const Run& r) {
+        return value < r.end_;
+    });
+
+    Run before(run->start_, start), after(end, run->end_);
+    run = row.erase(run);
+    if (after.start_ < after.end_)
+        run = row.insert(run, after);
+    if (before.start_ < before.end_)
+        row.insert(run, before);
+}
+
+
+
+//covers the blocks of layers [minD, maxD) with boxes, removing them as it goes
+void growRunCuboids(std::vector<IntervalVolume::Row>& blocks, std::size_t blocksPerSide,
+    std::size_t minD, std::size_t maxD, std::size_t blockSize, std::vector<Bounds2D>& boxes)
+{
+    for (std::size_t d = minD; d < maxD; d++)
+    {
+        for (std::size_t x = 0; x < blocksPerSide; x++)
+        {
+            IntervalVolume::Row& row = blocks[d * blocksPerSide + x];
+            while (!row.empty())
+            {
+                std::uint32_t y = row.front().start_, endY = row.front().end_;
+
+                std::size_t endX = x + 1;
+                while (endX < blocksPerSide && containsRun(blocks[d * blocksPerSide + endX], y, endY))
+                    endX++;
+
+                std::size_t endD = d + 1;
+                bool layerFree = true;
+                while (endD < maxD && layerFree)
+                {
+                    for (std::size_t r = x; r < endX && layerFree; r++)
+                        layerFree = containsRun(blocks[endD * blocksPerSide + r], y, endY);
+                    if (layerFree)
+                        endD++;
+                }
+
+                for (std::size_t q = d; q < endD; q++)
+                    for (std::size_t r = x; r < endX; r++)
+                        removeRun(blocks[q * blocksPerSide + r], y, endY);
+
+                boxes.push_back(std::make_pair(
+                    Point3D((int)(d * blockSize), (int)(x * blockSize), (int)(y * blockSize)),
+                    Point3D((int)(endD * blockSize), (int)(endX * blockSize), (int)(endY * blockSize))));
+            }
+        }
+    }
+}
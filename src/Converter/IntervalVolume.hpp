@@ -0,0 +1,57 @@
+#ifndef INTERVAL_VOLUME
+#define INTERVAL_VOLUME
+
+/**
+    An IntervalVolume keeps the inside voxels as the slices describe them:
+    each (d, x) row is a sorted list of disjoint runs along y, and all rows
+    are packed one after another, d-major. Its memory and the time of every
+    operation grow with the number of runs, not the number of voxels.
+
+    Components are found by flood filling over runs: a run reaches every
+    run it overlaps in the four neighboring rows. Cuboids are grown on runs
+    too. The runs of each block of rows are intersected to find the full
+    blocks, and boxes then grow from them just like greedy meshing grows
+    them on bits, so both give the same boxes.
+**/
+
+#include "main.hpp"
+#include "Run.struct"
+#include "Component.struct"
+#include <vector>
+
+class IntervalVolume
+{
+    public:
+        typedef std::vector<Run> Row;
+
+        IntervalVolume(std::size_t height, std::size_t size, const std::vector<Row>& rows);
+
+        std::size_t getHeight() const;
+        std::size_t getSize() const;
+        std::size_t getRunCount() const;
+        std::size_t count() const;
+
+        const std::vector<Component>& findComponents();
+        void keep(const std::vector<bool>& kept);
+        std::vector<Bounds2D> findCuboids(std::size_t blockSize) const;
+
+    private:
+        void floodFill(std::size_t run, std::size_t d, std::size_t x, Component& component);
+        std::vector<Row> findFullBlocks(std::size_t blockSize) const;
+
+    private:
+        std::size_t height_, size_;
+        std::vector<std::size_t> rowStarts_; //first run of each row, d-major
+        std::vector<Run> runs_;
+        std::vector<std::uint32_t> labels_; //components, once found
+        std::vector<Component> components_;
+};
+
+IntervalVolume::Row uniteRows(const IntervalVolume::Row& a, const IntervalVolume::Row& b);
+IntervalVolume::Row intersectRows(const IntervalVolume::Row& a, const IntervalVolume::Row& b);
+bool containsRun(const IntervalVolume::Row& row, std::uint32_t start, std::uint32_t end);
+void removeRun(IntervalVolume::Row& row, std::uint32_t start, std::uint32_t end);
+void growRunCuboids(std::vector<IntervalVolume::Row>& blocks, std::size_t blocksPerSide,
+    std::size_t minD, std::size_t maxD, std::size_t blockSize, std::vector<Bounds2D>& boxes);
+
+#endif
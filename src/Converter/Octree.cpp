@@ -0,0 +1,161 @@
+
+#include "Octree.hpp"
+#include "Parallel.hpp"
+#include <algorithm>
+
+
+const std::size_t REPORT_SIZE = 64; //nodes of this size report the build's progress
+
+
+//leafSize must be a power of two no larger than a word
+Octree::Octree(const Volume& volume, std::size_t leafSize) :
+    volume_(volume), leafSize_(leafSize), rootSize_(leafSize), reportSize_(0), reportTotal_(0), reported_(0)
+{
+    std::size_t smallest = std::min(volume.getHeight(), volume.getSize());
+    if (smallest < leafSize)
+        return;
+
+    while (rootSize_ * 2 <= smallest)
+        rootSize_ *= 2;
+
+    reportSize_ = std::min(std::max(REPORT_SIZE, leafSize_), rootSize_);
+    std::size_t rootsD = (volume.getHeight() + rootSize_ - 1) / rootSize_;
+    std::size_t rootsX = (volume.getSize() + rootSize_ - 1) / rootSize_;
+    std::size_t perRoot = rootSize_ / reportSize_;
+    reportTotal_ = rootsD * rootsX * rootsX * perRoot * perRoot * perRoot;
+    reportProgress(0, reportTotal_);
+
+    //roots that stick out of the volume can only ever be empty or mixed
+    for (std::size_t d = 0; d < volume.getHeight(); d += rootSize_)
+        for (std::size_t x = 0; x < volume.getSize(); x += rootSize_)
+            for (std::size_t y = 0; y < volume.getSize(); y += rootSize_)
+                roots_.push_back(build(d, x, y, rootSize_));
+}
+
+
+
+//returns every full node, smallest first and in d, x, y order within a size
+std::vector<Bounds2D> Octree::getFullNodes() const
+{
+    std::vector<Bounds2D> boxes;
+
+    std::size_t root = 0;
+    for (std::size_t d = 0; d < volume_.getHeight() && !roots_.empty(); d += rootSize_)
+        for (std::size_t x = 0; x < volume_.getSize(); x += rootSize_)
+            for (std::size_t y = 0; y < volume_.getSize(); y += rootSize_)
+                collectFull(roots_[root++], d, x, y, rootSize_, boxes);
+
+    std::sort(boxes.begin(), boxes.end(), [](const Bounds2D& a, const Bounds2D& b) {
+        int sizeA = a.second.d_ - a.first.d_, sizeB = b.second.d_ - b.first.d_;
+        if (sizeA != sizeB)
+            return sizeA < sizeB;
+        if (a.first.d_ != b.first.d_)
+            return a.first.d_ < b.first.d_;
+        if (a.first.x_ != b.first.x_)
+            return a.first.x_ < b.first.x_;
+        return a.first.y_ < b.first.y_;
+    });
+
+    return boxes;
+}
+
+
+
+std::size_t Octree::getNodeCount() const
+{
+    return roots_.size() + nodes_.size();
+}
+
+
+
+std::size_t Octree::getBytes() const
+{
+    return (roots_.capacity() + nodes_.capacity()) * sizeof(Node);
+}
+
+
+
+Octree::Node Octree::build(std::size_t d, std::size_t x, std::size_t y, std::size_t size)
+{
+    Node node = size == leafSize_ ? classifyLeaf(d, x, y) : combine(d, x, y, size);
+    if (size == reportSize_)
+        reportProgress(++reported_, reportTotal_);
+    return node;
+}
+
+
+
+//builds the node's eight children and collapses them if they agree
+Octree::Node Octree::combine(std::size_t d, std::size_t x, std::size_t y, std::size_t size)
+{
+    std::size_t half = size / 2;
+    Node children[8];
+    std::size_t full = 0, empty = 0;
+    for (std::size_t j = 0; j < 8; j++)
+    {
+        children[j] = build(d + (j >> 2) * half, x + ((j >> 1) & 1) * half, y + (j & 1) * half, half);
+        if (children[j].state_ == FULL)
+            full++;
+        else if (children[j].state_ == EMPTY)
+            empty++;
+    }
+
+    if (full == 8)
+        return Node{FULL, 0};
+    if (empty == 8)
+        return Node{EMPTY, 0};
+
+    Node node{MIXED, (std::uint32_t)nodes_.size()};
+    nodes_.insert(nodes_.end(), children, children + 8);
+    return node;
+}
+
+
+
+//ANDs and ORs the leaf's bits of each of its rows together
+Octree::Node Octree::classifyLeaf(std::size_t d, std::size_t x, std::size_t y) const
+{
+    if (d >= volume_.getHeight() || x >= volume_.getSize() || y >= volume_.getSize())
+        return Node{EMPTY, 0};
+
+    Volume::Word mask = leafSize_ == Volume::WORD_BITS ? ~(Volume::Word)0 : ((Volume::Word)1 << leafSize_) - 1;
+    Volume::Word all = mask, any = 0;
+    for (std::size_t q = d; q < d + leafSize_; q++)
+    {
+        for (std::size_t r = x; r < x + leafSize_; r++)
+        {
+            if (q >= volume_.getHeight() || r >= volume_.getSize())
+            {
+                all = 0;
+                continue;
+            }
+
+            Volume::Word bits = (volume_.getWord(q, r, y / Volume::WORD_BITS) >> (y % Volume::WORD_BITS)) & mask;
+            all &= bits;
+            any |= bits;
+        }
+    }
+
+    if (all == mask)
+        return Node{FULL, 0};
+    return Node{any == 0 ? EMPTY : MIXED, 0};
+}
+
+
+
+void Octree::collectFull(const Node& node, std::size_t d, std::size_t x, std::size_t y,
+    std::size_t size, std::vector<Bounds2D>& boxes) const
+{
+    if (node.state_ == FULL)
+    {
+        boxes.push_back(std::make_pair(Point3D((int)d, (int)x, (int)y),
+            Point3D((int)(d + size), (int)(x + size), (int)(y + size))));
+    }
+    else if (node.state_ == MIXED && size > leafSize_)
+    {
+        std::size_t half = size / 2;
+        for (std::size_t j = 0; j < 8; j++)
+            collectFull(nodes_[node.children_ + j], d + (j >> 2) * half,
+                x + ((j >> 1) & 1) * half, y + (j & 1) * half, half, boxes);
+    }
+}
@@ -0,0 +1,49 @@
+
+#ifndef OCTREE
+#define OCTREE
+
+/**
+    An Octree summarizes a Volume as aligned power-of-two cubes. It is built
+    bottom-up in a single depth-first pass: leaves are classified straight
+    from the volume's words, and a node whose eight children are all full or
+    all empty collapses into one node without children. Only mixed nodes
+    keep their children, so a full node is always the largest aligned cube
+    around its voxels.
+**/
+
+#include "main.hpp"
+#include "Volume.hpp"
+
+class Octree
+{
+    public:
+        Octree(const Volume& volume, std::size_t leafSize);
+
+        std::vector<Bounds2D> getFullNodes() const;
+        std::size_t getNodeCount() const;
+        std::size_t getBytes() const;
+
+    private:
+        enum State : std::uint8_t { EMPTY, FULL, MIXED };
+
+        struct Node
+        {
+            State state_;
+            std::uint32_t children_; //first of eight, if mixed above the leaves
+        };
+
+        Node build(std::size_t d, std::size_t x, std::size_t y, std::size_t size);
+        Node combine(std::size_t d, std::size_t x, std::size_t y, std::size_t size);
+        Node classifyLeaf(std::size_t d, std::size_t x, std::size_t y) const;
+        void collectFull(const Node& node, std::size_t d, std::size_t x, std::size_t y,
+            std::size_t size, std::vector<Bounds2D>& boxes) const;
+
+    private:
+        const Volume& volume_;
+        std::size_t leafSize_, rootSize_;
+        std::size_t reportSize_, reportTotal_, reported_; //nodes of that size pass on their progress
+        std::vector<Node> roots_; //tiling the volume in d, x, y order
+        std::vector<Node> nodes_;
+};
+
+#endif
@@ -0,0 +1,95 @@
+
+#include "Parallel.hpp"
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <algorithm>
+
+
+namespace
+{
+    std::size_t threadCount = 0; //0 means one per hardware thread
+    std::function<void(std::size_t, std::size_t)> progressReport;
+    thread_local bool isWorker = false; //nested loops do not report their own progress
+}
+
+
+
+void setThreadCount(std::size_t threads)
+{
+    threadCount = threads;
+}
+
+
+
+std::size_t getThreadCount()
+{
+    if (threadCount > 0)
+        return threadCount;
+    return std::max((std::size_t)std::thread::hardware_concurrency(), (std::size_t)1);
+}
+
+
+
+//returns parts + 1 boundaries dividing [0, count) into nearly equal ranges
+std::vector<std::size_t> splitEvenly(std::size_t count, std::size_t parts)
+{
+    std::vector<std::size_t> bounds;
+    for (std::size_t j = 0; j <= parts; j++)
+        bounds.push_back(count * j / parts);
+    return bounds;
+}
+
+
+
+//calls task(0) through task(tasks - 1), spread over the worker threads
+void runInParallel(std::size_t tasks, const std::function<void(std::size_t)>& task)
+{
+    const bool reports = progressReport && !isWorker;
+    std::atomic<std::size_t> next(0), done(0);
+    std::mutex reportMutex;
+    if (reports)
+        progressReport(0, tasks); //a new loop begins
+    auto worker = [&]() {
+        bool wasWorker = isWorker;
+        isWorker = true;
+        for (std::size_t j = next++; j < tasks; j = next++)
+        {
+            task(j);
+            if (reports)
+            {
+                std::size_t finished = ++done;
+                std::lock_guard<std::mutex> lock(reportMutex);
+                progressReport(finished, tasks);
+            }
+        }
+        isWorker = wasWorker;
+    };
+
+    std::vector<std::thread> threads;
+    std::size_t threadTotal = std::min(getThreadCount(), tasks);
+    for (std::size_t j = 1; j < threadTotal; j++)
+        threads.push_back(std::thread(worker));
+    worker();
+
+    for (auto& thread : threads)
+        thread.join();
+}
+
+
+
+//called with 0 done as an outermost loop begins, then after each of its
+//tasks from whichever thread ran it
+void setProgressReport(const std::function<void(std::size_t done, std::size_t tasks)>& report)
+{
+    progressReport = report;
+}
+
+
+
+//passes on the progress of a serial loop, which counts as an outermost loop
+void reportProgress(std::size_t done, std::size_t tasks)
+{
+    if (progressReport && !isWorker)
+        progressReport(done, tasks);
+}
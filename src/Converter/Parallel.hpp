@@ -0,0 +1,16 @@
+
+#ifndef PARALLEL
+#define PARALLEL
+
+#include <vector>
+#include <cstddef>
+#include <functional>
+
+void setThreadCount(std::size_t threads);
+std::size_t getThreadCount();
+std::vector<std::size_t> splitEvenly(std::size_t count, std::size_t parts);
+void runInParallel(std::size_t tasks, const std::function<void(std::size_t)>& task);
+void setProgressReport(const std::function<void(std::size_t done, std::size_t tasks)>& report);
+void reportProgress(std::size_t done, std::size_t tasks);
+
+#endif
@@ -0,0 +1,374 @@
+
+#include "SlabStream.hpp"
+#include "Components.hpp"
+#include "Octree.hpp"
+#include "Greedy.hpp"
+#include "GeometryFile.hpp"
+#include <algorithm>
+#include <numeric>
+#include <iostream>
+#include <cstdio>
+#include <map>
+#include <array>
+#include <stdexcept>
+
+
+const char* const SCRATCH_FILE = "geometry.scratch";
+const std::size_t GATHER_BYTES = sizeof(Component) + 4 * sizeof(std::uint32_t); //per label, to merge the parts at the end
+const std::size_t LABEL_BYTES = sizeof(std::uint32_t) + sizeof(Component) + GATHER_BYTES; //per label, from its slab on
+
+
+SlabStream::SlabStream(const std::vector<std::string>& files, std::size_t size, std::size_t slabHeight,
+    std::size_t minBoxSize, bool greedy) :
+    SlabStream([files, size](std::size_t minD, std::size_t maxD) {
+        return readMatrix(std::vector<std::string>(files.begin() + (std::ptrdiff_t)minD,
+            files.begin() + (std::ptrdiff_t)maxD), size);
+    }, files.size(), size, slabHeight, minBoxSize, greedy)
+{}
+
+
+
+SlabStream::SlabStream(const SlabSource& source, std::size_t height, std::size_t size,
+    std::size_t slabHeight, std::size_t minBoxSize, bool greedy) :
+    source_(source), height_(height), size_(size), slabHeight_(slabHeight),
+    minBoxSize_(minBoxSize), greedy_(greedy), budget_(0), slabs_(0), peakBytes_(0), spilled_(0)
+{}
+
+
+
+SlabStream::~SlabStream()
+{
+    std::remove(SCRATCH_FILE);
+}
+
+
+
+//0, the default, converts fixed slabs of slabHeight layers
+void SlabStream::setMemoryBudget(std::size_t bytes)
+{
+    budget_ = bytes;
+}
+
+
+
+void SlabStream::run()
+{
+    scratch_.open(SCRATCH_FILE, std::fstream::out | std::fstream::binary | std::fstream::trunc);
+
+    std::size_t slabHeight = budget_ == 0 ? slabHeight_ : std::min(minBoxSize_, slabHeight_);
+    std::size_t layerBytes = 0; //the most a layer has taken so far
+    for (std::size_t minD = 0; minD < height_;)
+    {
+        std::size_t maxD = std::min(minD + slabHeight, height_);
+        std::cout << "Slab " << minD << " - " << maxD << " / " << height_ << "... ";
+        std::cout.flush();
+
+        std::size_t bytes = 0;
+        bool fits = processSlab(minD, maxD, bytes);
+        layerBytes = std::max(layerBytes, (bytes + maxD - minD - 1) / (maxD - minD));
+        if (!fits)
+        {
+            std::cout << "takes " << (bytes >> 10) << " KB, over the budget." << std::endl;
+            if (slabHeight <= minBoxSize_)
+                throw std::runtime_error("A memory budget of " + std::to_string(budget_ >> 10) +
+                    " KB cannot hold a slab of " + std::to_string(minBoxSize_) + " layers!");
+            slabHeight = fitSlab(layerBytes, slabHeight - minBoxSize_);
+            continue;
+        }
+
+        std::cout << "done." << std::endl;
+        minD = maxD;
+        slabs_++;
+        if (budget_ != 0)
+            slabHeight = fitSlab(layerBytes, 2 * slabHeight);
+    }
+
+    for (const auto& box : openBoxes_)
+        spill(box);
+    openBoxes_.clear();
+    halo_.clear();
+
+    scratch_.close();
+    gatherComponents();
+}
+
+
+
+const std::vector<Component>& SlabStream::getComponents() const
+{
+    return components_;
+}
+
+
+
+std::size_t SlabStream::getSlabCount() const
+{
+    return slabs_;
+}
+
+
+
+//the most that a slab and everything held alongside it took, whether it fit or not
+std::size_t SlabStream::getPeakBytes() const
+{
+    return peakBytes_;
+}
+
+
+
+//visits the spilled boxes of the kept components, reading them back on every call
+BoxSource SlabStream::getKeptBoxes(const std::vector<bool>& kept) const
+{
+    return [this, kept](const BoxVisitor& visit) {
+        std::ifstream scratch(SCRATCH_FILE, std::ifstream::in | std::ifstream::binary);
+        for (std::size_t j = 0; j < spilled_; j++)
+        {
+            BoxRecord record;
+            std::uint32_t label;
+            scratch.read(reinterpret_cast<char*>(&record), sizeof(record));
+            scratch.read(reinterpret_cast<char*>(&label), sizeof(label));
+            if (!scratch)
+                break;
+
+            if (kept[labelComponents_[label]])
+                visit(std::make_pair(Point3D(record.d0_, record.x0_, record.y0_),
+                    Point3D(record.d1_, record.x1_, record.y1_)));
+        }
+    };
+}
+
+
+
+//converts the slab and returns true, unless what it takes in bytes would overrun the budget
+bool SlabStream::processSlab(std::size_t minD, std::size_t maxD, std::size_t& bytes)
+{
+    Volume slab = source_(minD, maxD);
+    ComponentLabels labels(slab);
+    bytes = slab.getBytes() + labels.getBytes() + labels.getComponents().size() * LABEL_BYTES;
+
+    std::vector<Bounds2D> boxes;
+    if (greedy_)
+    {
+        boxes = findCuboids(slab, minBoxSize_);
+        bytes += slab.getBytes() / (minBoxSize_ * minBoxSize_ * minBoxSize_) + //its grid of full blocks
+            boxes.capacity() * sizeof(Bounds2D); //which it gathers from each thread's share
+    }
+    else
+    {
+        Octree octree(slab, minBoxSize_);
+        std::vector<Bounds2D> nodes = octree.getFullNodes();
+        boxes = mergeRuns(nodes);
+        bytes += octree.getBytes() + nodes.capacity() * sizeof(Bounds2D) + nodes.size() / 8; //and the merged flags
+    }
+    bytes += boxes.capacity() * sizeof(Bounds2D) + boxes.size() * sizeof(TaggedBox);
+
+    peakBytes_ = std::max(peakBytes_, getHeldBytes() + bytes);
+    if (budget_ != 0 && getHeldBytes() + bytes > budget_)
+        return false;
+
+    if (parents_.size() + labels.getComponents().size() > ~(std::uint32_t)0)
+        throw std::runtime_error("The stream has more labels than 32 bits can number!");
+    auto base = (std::uint32_t)parents_.size();
+    for (auto part : labels.getComponents())
+    {
+        part.minD_ += minD;
+        part.maxD_ += minD;
+        parents_.push_back((std::uint32_t)parents_.size());
+        parts_.push_back(part);
+    }
+
+    //join the first layer to the halo where their runs overlap
+    std::size_t size = slab.getSize();
+    halo_.resize(size);
+    for (std::size_t x = 0; x < size; x++)
+    {
+        auto row = labels.getRow(0, x);
+        const auto& carried = halo_[x];
+        std::size_t a = 0, b = 0;
+        while (a < row.size() && b < carried.size())
+        {
+            const Run &runA = row[a].first, &runB = carried[b].first;
+            if (runA.start_ < runB.end_ && runB.start_ < runA.end_)
+                join(base + row[a].second, carried[b].second);
+
+            if (runA.end_ < runB.end_)
+                a++;
+            else
+                b++;
+        }
+    }
+
+    for (std::size_t x = 0; x < size; x++)
+    {
+        halo_[x] = labels.getRow(slab.getHeight() - 1, x);
+        for (auto& run : halo_[x])
+            run.second += base;
+    }
+
+    //boxes are entirely inside, so any of their voxels gives the component
+    std::vector<TaggedBox> tagged;
+    tagged.reserve(boxes.size());
+    for (auto box : boxes)
+    {
+        std::uint32_t label = base + labels.getComponentAt((std::size_t)box.first.d_,
+            (std::size_t)box.first.x_, (std::size_t)box.first.y_);
+        box.first.d_ += (int)minD;
+        box.second.d_ += (int)minD;
+        tagged.push_back(std::make_pair(box, label));
+    }
+
+    stitch(tagged, minD, maxD);
+    return true;
+}
+
+
+
+//returns the most layers, up to most, that fit beside what is held at layerBytes each
+std::size_t SlabStream::fitSlab(std::size_t layerBytes, std::size_t most) const
+{
+    std::size_t held = getHeldBytes();
+    std::size_t layers = held < budget_ ? (budget_ - held) / std::max(layerBytes, (std::size_t)1) : 0;
+    layers = std::min(std::min(layers, most), slabHeight_) / minBoxSize_ * minBoxSize_;
+    return std::max(layers, minBoxSize_);
+}
+
+
+
+//what stays from slab to slab, growing with the labels seen so far
+std::size_t SlabStream::getHeldBytes() const
+{
+    std::size_t bytes = parents_.capacity() * sizeof(std::uint32_t) + parts_.capacity() * sizeof(Component) +
+        parents_.size() * GATHER_BYTES + openBoxes_.capacity() * sizeof(TaggedBox);
+    for (const auto& row : halo_)
+        bytes += row.capacity() * sizeof(row[0]);
+    return bytes;
+}
+
+
+
+//extends the boxes held at the seam into this slab's boxes with the same
+//footprint, then holds back the boxes that end on the next seam
+void SlabStream::stitch(std::vector<TaggedBox>& boxes, std::size_t minD, std::size_t maxD)
+{
+    std::map<std::array<int, 4>, std::size_t> footprints; //open boxes don't overlap
+    for (std::size_t j = 0; j < openBoxes_.size(); j++)
+    {
+        const Bounds2D& box = openBoxes_[j].first;
+        footprints[{{box.first.x_, box.first.y_, box.second.x_, box.second.y_}}] = j;
+    }
+
+    std::vector<bool> extended(openBoxes_.size(), false);
+    for (auto& box : boxes)
+    {
+        if (box.first.first.d_ != (int)minD)
+            continue;
+
+        const Bounds2D& bounds = box.first;
+        auto match = footprints.find({{bounds.first.x_, bounds.first.y_, bounds.second.x_, bounds.second.y_}});
+        if (match != footprints.end())
+        {
+            box.first.first.d_ = openBoxes_[match->second].first.first.d_;
+            extended[match->second] = true;
+        }
+    }
+
+    for (std::size_t j = 0; j < openBoxes_.size(); j++)
+        if (!extended[j])
+            spill(openBoxes_[j]);
+
+    openBoxes_.clear();
+    for (const auto& box : boxes)
+    {
+        if (box.first.second.d_ == (int)maxD && maxD < height_)
+            openBoxes_.push_back(box);
+        else
+            spill(box);
+    }
+}
+
+
+
+void SlabStream::spill(const TaggedBox& box)
+{
+    const Bounds2D& bounds = box.first;
+    BoxRecord record = {
+        (std::int16_t)bounds.first.d_, (std::int16_t)bounds.first.x_, (std::int16_t)bounds.first.y_,
+        (std::int16_t)bounds.second.d_, (std::int16_t)bounds.second.x_, (std::int16_t)bounds.second.y_};
+    scratch_.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    scratch_.write(reinterpret_cast<const char*>(&box.second), sizeof(box.second));
+    spilled_++;
+}
+
+
+
+void SlabStream::join(std::uint32_t labelA, std::uint32_t labelB)
+{
+    labelA = find(labelA);
+    labelB = find(labelB);
+    if (labelA < labelB)
+        parents_[labelB] = labelA;
+    else if (labelB < labelA)
+        parents_[labelA] = labelB;
+}
+
+
+
+std::uint32_t SlabStream::find(std::uint32_t label)
+{
+    while (parents_[label] != label)
+    {
+        parents_[label] = parents_[parents_[label]];
+        label = parents_[label];
+    }
+
+    return label;
+}
+
+
+
+//merges the parts of each component into one, then numbers them largest first
+void SlabStream::gatherComponents()
+{
+    std::vector<Component> merged;
+    std::vector<std::uint32_t> rootIndex(parents_.size(), 0);
+    for (std::uint32_t label = 0; label < parents_.size(); label++)
+    {
+        const Component& part = parts_[label];
+        std::uint32_t root = find(label);
+        if (root == label)
+        {
+            rootIndex[label] = (std::uint32_t)merged.size();
+            merged.push_back(part);
+            continue;
+        }
+
+        Component& whole = merged[rootIndex[root]]; //roots come first
+        whole.voxels_ += part.voxels_;
+        whole.minD_ = std::min(whole.minD_, part.minD_);
+        whole.minX_ = std::min(whole.minX_, part.minX_);
+        whole.minY_ = std::min(whole.minY_, part.minY_);
+        whole.maxD_ = std::max(whole.maxD_, part.maxD_);
+        whole.maxX_ = std::max(whole.maxX_, part.maxX_);
+        whole.maxY_ = std::max(whole.maxY_, part.maxY_);
+    }
+
+    std::vector<std::uint32_t> order(merged.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) {
+        return merged[a].voxels_ > merged[b].voxels_;
+    });
+
+    std::vector<std::uint32_t> renumber(merged.size());
+    for (std::size_t j = 0; j < order.size(); j++)
+    {
+        renumber[order[j]] = (std::uint32_t)j;
+        components_.push_back(merged[order[j]]);
+    }
+
+    labelComponents_.assign(parents_.size(), 0);
+    for (std::uint32_t label = 0; label < parents_.size(); label++)
+        labelComponents_[label] = renumber[rootIndex[find(label)]];
+
+    std::vector<std::uint32_t>().swap(parents_);
+    std::vector<Component>().swap(parts_);
+}
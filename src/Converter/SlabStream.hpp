@@ -0,0 +1,90 @@
+
+#ifndef SLAB_STREAM
+#define SLAB_STREAM
+
+/**
+    A SlabStream converts the slices a few layers at a time, so that only
+    one slab of the volume is ever in memory. Each slab is labelled on its
+    own, and its components get labels that are unique across the whole
+    stack. The runs of a slab's last layer are carried over as a one-layer
+    halo, and the next slab's components are joined to the carried labels
+    wherever their first-layer runs overlap.
+
+    Boxes are extracted per slab and tagged with their component. A box
+    that ends on a seam is held back until the next slab, and is extended
+    into a box there that starts on the seam with the same footprint. All
+    other boxes are spilled to a scratch file. Only once every slab has
+    been seen are the components known, and the scratch file is then
+    filtered down to the boxes of the kept components, on every pass a
+    writer makes over them, so they are never all held at once.
+
+    Without a memory budget every slab has slabHeight layers. With one, the
+    stream starts at minBoxSize layers and measures what each slab really
+    takes: the layers, their labels and runs, the octree or block grid, the
+    boxes, and what is held from slab to slab, which grows with the labels
+    seen so far. The next slab is sized by the costliest layer yet, at most
+    doubling and never above slabHeight. A slab that turns out larger than
+    the budget is dropped and taken again with fewer layers, so the source
+    must be able to produce the same layers twice; if even minBoxSize
+    layers do not fit, run() throws.
+
+    The slabs are read from the slice files, or taken from any other
+    source that can produce the layers of a slab in order, such as the
+    pipeline's slices as they are rendered.
+**/
+
+#include "main.hpp"
+#include "Volume.hpp"
+#include "Run.struct"
+#include "Component.struct"
+#include <fstream>
+#include <functional>
+
+class SlabStream
+{
+    public:
+        typedef std::function<Volume(std::size_t minD, std::size_t maxD)> SlabSource;
+
+        SlabStream(const std::vector<std::string>& files, std::size_t size, std::size_t slabHeight,
+            std::size_t minBoxSize, bool greedy);
+        SlabStream(const SlabSource& source, std::size_t height, std::size_t size,
+            std::size_t slabHeight, std::size_t minBoxSize, bool greedy);
+        ~SlabStream();
+
+        void setMemoryBudget(std::size_t bytes);
+        void run();
+        const std::vector<Component>& getComponents() const;
+        std::size_t getSlabCount() const;
+        std::size_t getPeakBytes() const;
+        BoxSource getKeptBoxes(const std::vector<bool>& kept) const;
+
+    private:
+        typedef std::pair<Bounds2D, std::uint32_t> TaggedBox;
+
+        bool processSlab(std::size_t minD, std::size_t maxD, std::size_t& bytes);
+        std::size_t fitSlab(std::size_t layerBytes, std::size_t most) const;
+        std::size_t getHeldBytes() const;
+        void stitch(std::vector<TaggedBox>& boxes, std::size_t minD, std::size_t maxD);
+        void spill(const TaggedBox& box);
+        void join(std::uint32_t labelA, std::uint32_t labelB);
+        std::uint32_t find(std::uint32_t label);
+        void gatherComponents();
+
+    private:
+        SlabSource source_;
+        std::size_t height_, size_, slabHeight_, minBoxSize_;
+        bool greedy_;
+        std::size_t budget_, slabs_, peakBytes_;
+
+        std::vector<std::uint32_t> parents_; //union-find over the labels of all slabs
+        std::vector<Component> parts_; //each label's share of its component
+        std::vector<std::vector<std::pair<Run, std::uint32_t>>> halo_;
+        std::vector<TaggedBox> openBoxes_; //boxes that end on the last seam
+        std::fstream scratch_;
+        std::size_t spilled_;
+
+        std::vector<Component> components_; //largest first, once run
+        std::vector<std::uint32_t> labelComponents_; //component of each label, once run
+};
+
+#endif
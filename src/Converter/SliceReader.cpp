@@ -0,0 +1,125 @@
+
+#include "SliceReader.hpp"
+#include <fstream>
+#include <stdexcept>
+
+
+namespace
+{
+    std::ifstream::pos_type getFileSize(const std::string& filename)
+    {
+        std::ifstream file(filename, std::ifstream::in | std::ifstream::binary | std::ifstream::ate);
+        if (file.fail())
+            return -1;
+        return file.tellg();
+    }
+}
+
+
+
+//returns a message for every file that is missing or cannot hold a line per row
+std::vector<std::string> findBadSlices(const std::vector<std::string>& filenames, std::size_t size)
+{
+    std::vector<std::string> problems;
+    for (const auto& filename : filenames)
+    {
+        std::ifstream::pos_type bytes = getFileSize(filename);
+        if (bytes < 0)
+            problems.push_back("Unable to open \"" + filename + "\"!");
+        else if ((std::size_t)bytes < 2 * size) //every row has at least one digit and a newline
+            problems.push_back("\"" + filename + "\" is too short!");
+    }
+
+    return problems;
+}
+
+
+
+//returns the file's contents with a single read
+std::string readWholeFile(const std::string& filename)
+{
+    std::ifstream file(filename, std::ifstream::in | std::ifstream::binary);
+    if (file.fail())
+        throw std::runtime_error("Unable to open \"" + filename + "\"!");
+
+    file.seekg(0, std::ifstream::end);
+    std::string text((std::size_t)file.tellg(), '\0');
+    file.seekg(0, std::ifstream::beg);
+    file.read(&text[0], (std::streamsize)text.size());
+    file.close();
+    return text;
+}
+
+
+
+//returns the inside runs of each row, throwing unless the file has size rows of size voxels
+std::vector<std::vector<Run>> readSliceRuns(const std::string& filename, std::size_t size)
+{
+    std::string text = readWholeFile(filename);
+
+    std::vector<std::vector<Run>> rows(size);
+    const char* c = text.data();
+    const char* end = c + text.size();
+    std::size_t x = 0;
+    while (c < end && x < size)
+    {
+        std::size_t y = 0;
+        bool inside = false;
+        while (c < end && *c != '\n')
+        {
+            if ((unsigned)(*c - '0') > 9) //spaces, tabs and carriage returns
+            {
+                if (*c != ' ' && *c != '\t' && *c != '\r')
+                    throw std::runtime_error("\"" + filename + "\" has a bad character in row " +
+                        std::to_string(x) + "!");
+                c++;
+                continue;
+            }
+
+            //no run can be longer than the row, which also keeps the number from overflowing
+            std::size_t length = 0;
+            for (unsigned digit; c < end && (digit = (unsigned)(*c - '0')) <= 9; c++)
+            {
+                length = length * 10 + digit;
+                if (length > size - y)
+                    throw std::runtime_error("\"" + filename + "\" has row " + std::to_string(x) +
+                        " longer than " + std::to_string(size) + " voxels!");
+            }
+
+            //an empty gap joins its neighbors
+            std::size_t runEnd = y + length;
+            if (inside && y < runEnd)
+            {
+                if (!rows[x].empty() && rows[x].back().end_ == y)
+                    rows[x].back().end_ = (std::uint32_t)runEnd;
+                else
+                    rows[x].push_back(Run((std::uint32_t)y, (std::uint32_t)runEnd));
+            }
+            y += length;
+            inside = !inside;
+        }
+
+        if (y != size)
+            throw std::runtime_error("\"" + filename + "\" has row " + std::to_string(x) + " of " +
+                std::to_string(y) + " voxels but " + std::to_string(size) + " are required!");
+        if (c < end)
+            c++;
+        x++;
+    }
+
+    if (x < size)
+        throw std::runtime_error("\"" + filename + "\" has " + std::to_string(x) +
+            " rows but " + std::to_string(size) + " are required!");
+    return rows;
+}
+
+
+
+//sets the inside runs of the file as layer d of the volume
+void readSlice(const std::string& filename, Volume& volume, std::size_t d)
+{
+    std::vector<std::vector<Run>> rows = readSliceRuns(filename, volume.getSize());
+    for (std::size_t x = 0; x < rows.size(); x++)
+        for (const auto& run : rows[x])
+            volume.setRun(d, x, run.start_, run.end_ - run.start_);
+}
@@ -0,0 +1,24 @@
+#ifndef SLICE_READER
+#define SLICE_READER
+
+/**
+    Slice files hold one line per x row of a layer, each a list of run
+    lengths along y that alternate between outside and inside, starting
+    outside. The reader loads a whole file with a single read and parses
+    the digits by hand, without streams or locales, into the inside runs
+    of each row. These are either kept as runs or set into a volume;
+    different layers touch different words of the volume, so any number
+    of files can be read at the same time.
+**/
+
+#include "Volume.hpp"
+#include "Run.struct"
+#include <vector>
+#include <string>
+
+std::vector<std::string> findBadSlices(const std::vector<std::string>& filenames, std::size_t size);
+std::string readWholeFile(const std::string& filename);
+std::vector<std::vector<Run>> readSliceRuns(const std::string& filename, std::size_t size);
+void readSlice(const std::string& filename, Volume& volume, std::size_t d);
+
+#endif
@@ -0,0 +1,129 @@
+
+#include "StageLog.hpp"
+#include "Parallel.hpp"
+#include <sys/resource.h>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+
+const double REPORT_INTERVAL = 10; //seconds between progress lines
+
+
+
+StageLog::StageLog(const std::string& filename) :
+    voxels_(0), passes_(1), pass_(0), cpuStart_(0), reported_(false)
+{
+    log_.open(filename, std::ofstream::out);
+    if (log_.fail())
+        std::cout << "Unable to write \"" << filename << "\"!" << std::endl;
+}
+
+
+
+StageLog::~StageLog()
+{
+    setProgressReport(nullptr);
+}
+
+
+
+//voxels is the work of each pass over the volume, from which its rate and time left follow
+void StageLog::begin(const std::string& stage, std::uint64_t voxels, std::size_t passes)
+{
+    stage_ = stage;
+    voxels_ = voxels;
+    passes_ = std::max(passes, (std::size_t)1);
+    pass_ = 0;
+    notes_.clear();
+    reported_ = false;
+    setProgressReport([this](std::size_t done, std::size_t tasks) { reportProgress(done, tasks); });
+
+    cpuStart_ = getCpuSeconds();
+    start_ = passStart_ = lastReport_ = Clock::now();
+    misses_.start();
+}
+
+
+
+void StageLog::note(const std::string& key, std::uint64_t value)
+{
+    notes_.push_back(std::make_pair(key, value));
+}
+
+
+
+void StageLog::end()
+{
+    std::uint64_t misses = misses_.stop();
+    double wall = std::chrono::duration<double>(Clock::now() - start_).count();
+    double cpu = getCpuSeconds() - cpuStart_;
+    setProgressReport(nullptr);
+
+    log_ << "{\"stage\": \"" << stage_ << "\", \"wall_s\": " << wall << ", \"cpu_s\": " << cpu <<
+        ", \"peak_rss_kb\": " << getPeakMemory() << ", \"voxels\": " << voxels_ <<
+        ", \"voxels_per_s\": " << (wall > 0 ? (double)voxels_ / wall : 0);
+    if (misses_.isAvailable())
+        log_ << ", \"cache_misses\": " << misses;
+    for (const auto& note : notes_)
+        log_ << ", \"" << note.first << "\": " << note.second;
+    log_ << "}" << std::endl;
+}
+
+
+
+//a loop of the stage began, with 0 done, or finished another task; the rate assumes its tasks are alike
+void StageLog::reportProgress(std::size_t done, std::size_t tasks)
+{
+    Clock::time_point now = Clock::now();
+    if (done == 0)
+    {
+        pass_++;
+        passStart_ = now;
+        return;
+    }
+    if (std::chrono::duration<double>(now - lastReport_).count() < REPORT_INTERVAL || done == tasks)
+        return;
+    lastReport_ = now;
+
+    double fraction = (double)done / (double)tasks;
+    double passElapsed = std::chrono::duration<double>(now - passStart_).count();
+    double left = passElapsed * (1 - fraction) / fraction;
+    if (pass_ <= passes_) //the passes to come take as long as this one
+        left += (double)(passes_ - pass_) * passElapsed / fraction;
+
+    std::ios_base::fmtflags flags = std::cout.flags();
+    std::streamsize precision = std::cout.precision();
+    if (!reported_) //the stage's own output is waiting for the rest of its line
+        std::cout << std::endl;
+    reported_ = true;
+    std::cout << "[" << stage_ << "] pass " << pass_;
+    if (pass_ <= passes_)
+        std::cout << " of " << passes_;
+    std::cout << ": " << std::fixed << std::setprecision(1) << 100 * fraction << "% of " << tasks <<
+        " tasks, " << (double)voxels_ * fraction / passElapsed / 1e6 << " Mvoxel/s, about " << left <<
+        (pass_ <= passes_ ? " s left" : " s left in this pass") << std::endl;
+    std::cout.flags(flags);
+    std::cout.precision(precision);
+}
+
+
+
+//user and system time of all the process's threads
+double getCpuSeconds()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (double)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+        (double)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+
+
+//in kilobytes, as Linux reports it
+std::uint64_t getPeakMemory()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (std::uint64_t)usage.ru_maxrss;
+}
@@ -0,0 +1,55 @@
+#ifndef STAGE_LOG
+#define STAGE_LOG
+
+/**
+    A StageLog measures the converter's stages as they run: wall and CPU
+    time, the peak resident memory so far, the voxels handled per second
+    and, where perf events allow, the cache misses. Each finished stage
+    becomes one JSON object per line in the log file, together with any
+    counts noted for it, so that runs can be scraped for job sizing.
+
+    While a stage runs its loops report their progress, which the log
+    turns into an occasional line with the rate and the time left, so that
+    a slow run can be told apart from a stuck one. A stage may pass through
+    the volume several times; given how many, the time left is that of the
+    whole stage, taking the passes as equally long. Passes beyond those
+    expected only estimate their own time left.
+**/
+
+#include "CacheMisses.hpp"
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+class StageLog
+{
+    public:
+        StageLog(const std::string& filename);
+        ~StageLog();
+
+        void begin(const std::string& stage, std::uint64_t voxels, std::size_t passes = 1);
+        void note(const std::string& key, std::uint64_t value);
+        void end();
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        void reportProgress(std::size_t done, std::size_t tasks);
+
+        std::ofstream log_;
+        CacheMissCounter misses_;
+        std::string stage_;
+        std::uint64_t voxels_;
+        std::vector<std::pair<std::string, std::uint64_t>> notes_;
+        std::size_t passes_, pass_; //expected, and begun so far
+        Clock::time_point start_, passStart_, lastReport_;
+        double cpuStart_;
+        bool reported_;
+};
+
+double getCpuSeconds();
+std::uint64_t getPeakMemory();
+
+#endif
@@ -0,0 +1,629 @@
+
+#include "main.hpp"
+#include "Parallel.hpp"
+#include "SliceReader.hpp"
+#include "IntervalVolume.hpp"
+#include "ConversionCache.hpp"
+#include "Greedy.hpp"
+#include "Components.hpp"
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <numeric>
+#include <algorithm>
+#include <iostream>
+#include <cstdlib>
+#include <cstdio>
+
+
+const std::size_t BRICK_SIZE = 64; //of the binary geometry, for the renderer to cull
+
+
+
+bool hasFlag(int argc, char** argv, const std::string& flag)
+{
+    for (int j = 1; j < argc; j++)
+        if (flag == argv[j])
+            return true;
+    return false;
+}
+
+
+
+//returns the number following the flag, or the default if it is absent
+unsigned int getOption(int argc, char** argv, const std::string& flag, unsigned int defaultValue)
+{
+    for (int j = 1; j + 1 < argc; j++)
+    {
+        if (flag == argv[j])
+        {
+            char* end;
+            unsigned long value = std::strtoul(argv[j + 1], &end, 10);
+            if (*end == '\0' && value > 0)
+                return (unsigned int)value;
+        }
+    }
+
+    return defaultValue;
+}
+
+
+
+//returns the slice filenames in height order, or nothing if there is no manifest
+std::vector<std::string> readManifest(const std::string& filename)
+{
+    std::vector<std::string> files;
+
+    std::ifstream file;
+    file.open(filename, std::ifstream::in);
+    if (file.fail())
+        return files;
+
+    std::string line;
+    while (getline(file, line))
+    {
+        std::istringstream is(line);
+        std::size_t height;
+        float d;
+        std::string sliceFile;
+        if (is >> height >> d >> sliceFile)
+            files.push_back(sliceFile);
+    }
+
+    file.close();
+    return files;
+}
+
+
+
+//reads the slices concurrently into a new volume, one layer each
+Volume readMatrix(const std::vector<std::string>& filenames, std::size_t size)
+{
+    Volume volume(filenames.size(), size);
+    std::vector<std::size_t> layers(filenames.size());
+    std::iota(layers.begin(), layers.end(), 0);
+    readSlices(filenames, layers, volume);
+    return volume;
+}
+
+
+
+//replaces the given layers of the volume, reading their slices concurrently
+//and throwing the first error any of them ran into
+void readSlices(const std::vector<std::string>& filenames, const std::vector<std::size_t>& layers, Volume& volume)
+{
+    std::vector<std::string> errors(layers.size());
+    runInParallel(layers.size(), [&](std::size_t j) {
+        std::size_t d = layers[j];
+        for (std::size_t x = 0; x < volume.getSize(); x++)
+            for (std::size_t w = 0; w < volume.getRowWords(); w++)
+                volume.getWord(d, x, w) = 0;
+
+        try
+        {
+            readSlice(filenames[d], volume, d);
+        }
+        catch (const std::runtime_error& error)
+        {
+            errors[j] = error.what();
+        }
+    });
+
+    for (const auto& error : errors)
+        if (!error.empty())
+            throw std::runtime_error(error);
+}
+
+
+
+//returns the content hash of each slice
+std::vector<std::uint64_t> hashSlices(const std::vector<std::string>& filenames)
+{
+    std::vector<std::uint64_t> hashes(filenames.size());
+    std::vector<std::string> errors(filenames.size());
+    runInParallel(filenames.size(), [&](std::size_t d) {
+        try
+        {
+            std::string text = readWholeFile(filenames[d]);
+            hashes[d] = hashBytes(text.data(), text.size());
+        }
+        catch (const std::runtime_error& error)
+        {
+            errors[d] = error.what();
+        }
+    });
+
+    for (const auto& error : errors)
+        if (!error.empty())
+            throw std::runtime_error(error);
+    return hashes;
+}
+
+
+
+//reads the slices concurrently as runs, throwing the first error any of them ran into
+IntervalVolume readIntervals(const std::vector<std::string>& filenames, std::size_t size)
+{
+    std::vector<IntervalVolume::Row> rows(filenames.size() * size);
+
+    std::vector<std::string> errors(filenames.size());
+    runInParallel(filenames.size(), [&](std::size_t d) {
+        try
+        {
+            std::vector<IntervalVolume::Row> layer = readSliceRuns(filenames[d], size);
+            std::move(layer.begin(), layer.end(), rows.begin() + (std::ptrdiff_t)(d * size));
+        }
+        catch (const std::runtime_error& error)
+        {
+            errors[d] = error.what();
+        }
+    });
+
+    for (const auto& error : errors)
+        if (!error.empty())
+            throw std::runtime_error(error);
+
+    return IntervalVolume(filenames.size(), size, rows);
+}
+
+
+
+//without a minimum size only the largest survives, like the seeded fill
+std::vector<bool> selectComponents(const std::vector<Component>& components, std::size_t minSize)
+{
+    std::vector<bool> kept(components.size(), false);
+    for (std::size_t j = 0; j < components.size(); j++)
+        kept[j] = minSize == 0 ? j == 0 : components[j].voxels_ >= minSize;
+    return kept;
+}
+
+
+
+//one line per component, largest first: voxels, then minimum and maximum corners
+void writeComponents(const std::vector<Component>& components, std::string filename)
+{
+    std::ofstream fout;
+    fout.open(filename, std::ofstream::out);
+
+    for (const auto& component : components)
+        fout << component.voxels_ <<
+            " " << component.minD_ << " " << component.minX_ << " " << component.minY_ <<
+            " " << component.maxD_ << " " << component.maxX_ << " " << component.maxY_ << "\n";
+
+    fout.close();
+}
+
+
+
+//keeps only the 6-connected component of the volume that holds the start
+//position, by flooding it a row of 64-voxel words at a time
+//returns how many rows were taken off the pending list, which is the loop's work
+std::size_t removeIslands(Volume& volume, std::size_t startD, std::size_t startX, std::size_t startY)
+{
+    const std::size_t height = volume.getHeight(), size = volume.getSize();
+
+    if (!volume.get(startD, startX, startY))
+        std::cout << "WARNING: start position is not in set!" << std::endl;
+    volume.set(startD, startX, startY); //the start is always kept
+    Volume reached(height, size);
+    reached.set(startD, startX, startY);
+
+    //rows whose reached voxels may not have been passed on yet
+    std::vector<std::pair<std::size_t, std::size_t>> pending;
+    std::vector<bool> isPending(height * size, false);
+    pending.push_back(std::make_pair(startD, startX));
+    isPending[startD * size + startX] = true;
+
+    //progress is the rows filled at least once, out of all rows, so the time left is an upper bound
+    std::vector<bool> isFilled(height * size, false);
+    std::size_t filledRows = 0;
+    reportProgress(0, height * size);
+
+    std::size_t iterations = 0;
+    while (!pending.empty())
+    {
+        iterations++;
+        std::size_t d = pending.back().first, x = pending.back().second;
+        pending.pop_back();
+        isPending[d * size + x] = false;
+        if (!isFilled[d * size + x])
+        {
+            isFilled[d * size + x] = true;
+            reportProgress(++filledRows, height * size);
+        }
+
+        fillRow(volume, reached, d, x);
+
+        const std::size_t neighbors[4][2] = {
+            {d - 1, x}, {d + 1, x}, {d, x - 1}, {d, x + 1}
+        }; //out of range rows wrap around to huge indices
+
+        for (const auto& neighbor : neighbors)
+        {
+            std::size_t nD = neighbor[0], nX = neighbor[1];
+            if (nD >= height || nX >= size)
+                continue;
+
+            if (spreadRow(volume, reached, d, x, nD, nX) && !isPending[nD * size + nX])
+            {
+                pending.push_back(std::make_pair(nD, nX));
+                isPending[nD * size + nX] = true;
+            }
+        }
+    }
+
+    volume = reached; //all marked are good, otherwise remove
+    return iterations;
+}
+
+
+
+//grows the reached voxels of a row along y to cover every inside run they touch
+void fillRow(const Volume& volume, Volume& reached, std::size_t d, std::size_t x)
+{
+    const std::size_t rowWords = volume.getRowWords();
+
+    Volume::Word carry = 0; //toward higher y, Kogge-Stone style
+    for (std::size_t w = 0; w < rowWords; w++)
+    {
+        Volume::Word inside = volume.getWord(d, x, w);
+        Volume::Word& fill = reached.getWord(d, x, w);
+        fill |= carry & inside;
+        for (std::size_t shift = 1; shift < Volume::WORD_BITS; shift *= 2)
+        {
+            fill |= inside & (fill << shift);
+            inside &= inside << shift;
+        }
+        carry = fill >> (Volume::WORD_BITS - 1);
+    }
+
+    carry = 0; //toward lower y
+    for (std::size_t w = rowWords; w-- > 0;)
+    {
+        Volume::Word inside = volume.getWord(d, x, w);
+        Volume::Word& fill = reached.getWord(d, x, w);
+        fill |= (carry << (Volume::WORD_BITS - 1)) & inside;
+        for (std::size_t shift = 1; shift < Volume::WORD_BITS; shift *= 2)
+        {
+            fill |= inside & (fill >> shift);
+            inside &= inside >> shift;
+        }
+        carry = fill & 1;
+    }
+}
+
+
+
+//marks the inside voxels of row (toD, toX) next to reached voxels of row
+//(fromD, fromX), returning true if any were newly reached
+bool spreadRow(const Volume& volume, Volume& reached,
+    std::size_t fromD, std::size_t fromX, std::size_t toD, std::size_t toX)
+{
+    bool spread = false;
+    for (std::size_t w = 0; w < volume.getRowWords(); w++)
+    {
+        Volume::Word& fill = reached.getWord(toD, toX, w);
+        Volume::Word added = reached.getWord(fromD, fromX, w) & volume.getWord(toD, toX, w) & ~fill;
+        if (added != 0)
+        {
+            fill |= added;
+            spread = true;
+        }
+    }
+
+    return spread;
+}
+
+
+
+//marks every empty voxel that the volume's faces cannot reach as inside, so
+//that pockets sealed within the fractal leave no hidden surfaces or boxes
+//returns how many voxels were filled
+std::size_t fillCavities(Volume& volume)
+{
+    const std::size_t height = volume.getHeight(), size = volume.getSize(), rowWords = volume.getRowWords();
+    const std::size_t tail = size % Volume::WORD_BITS; //bits past the row's end stay clear
+    const Volume::Word lastMask = tail == 0 ? ~(Volume::Word)0 : ((Volume::Word)1 << tail) - 1;
+
+    Volume empty(height, size);
+    runInParallel(height, [&](std::size_t d) {
+        for (std::size_t x = 0; x < size; x++)
+            for (std::size_t w = 0; w < rowWords; w++)
+                empty.getWord(d, x, w) = ~volume.getWord(d, x, w) & (w + 1 == rowWords ? lastMask : ~(Volume::Word)0);
+    });
+
+    //empty components touching a face are the outside, all others are cavities
+    ComponentLabels labels(empty);
+    const std::vector<Component>& components = labels.getComponents();
+    std::vector<bool> cavities(components.size(), false);
+    std::size_t filled = 0;
+    for (std::size_t j = 0; j < components.size(); j++)
+    {
+        const Component& component = components[j];
+        cavities[j] = component.minD_ > 0 && component.minX_ > 0 && component.minY_ > 0 &&
+            component.maxD_ < height && component.maxX_ < size && component.maxY_ < size;
+        if (cavities[j])
+            filled += component.voxels_;
+    }
+
+    labels.keep(empty, cavities);
+    runInParallel(height, [&](std::size_t d) {
+        for (std::size_t x = 0; x < size; x++)
+            for (std::size_t w = 0; w < rowWords; w++)
+                volume.getWord(d, x, w) |= empty.getWord(d, x, w);
+    });
+
+    return filled;
+}
+
+
+
+//joins full octree nodes of the same size that line up along d, x or y into
+//longer boxes, taking the longest run from each remaining node in order
+std::vector<Bounds2D> mergeRuns(const std::vector<Bounds2D>& nodes)
+{
+    auto isBefore = [](const Bounds2D& a, const Bounds2D& b) {
+        int sizeA = a.second.d_ - a.first.d_, sizeB = b.second.d_ - b.first.d_;
+        if (sizeA != sizeB)
+            return sizeA < sizeB;
+        if (a.first.d_ != b.first.d_)
+            return a.first.d_ < b.first.d_;
+        if (a.first.x_ != b.first.x_)
+            return a.first.x_ < b.first.x_;
+        return a.first.y_ < b.first.y_;
+    };
+
+    std::vector<bool> merged(nodes.size(), false);
+    auto isAvailable = [&](const Point3D& corner, int boxSize) {
+        Bounds2D node = std::make_pair(corner, Point3D(corner.d_ + boxSize, 0, 0));
+        auto found = std::lower_bound(nodes.begin(), nodes.end(), node, isBefore);
+        if (found == nodes.end() || isBefore(node, *found))
+            return nodes.size();
+        std::size_t index = (std::size_t)(found - nodes.begin());
+        return merged[index] ? nodes.size() : index;
+    };
+
+    std::vector<Bounds2D> boxes;
+    for (std::size_t j = 0; j < nodes.size(); j++)
+    {
+        if (merged[j])
+            continue;
+
+        Point3D start = nodes[j].first;
+        int boxSize = nodes[j].second.d_ - start.d_;
+
+        //runs along d, x and y, in nodes after the first
+        std::vector<std::size_t> runs[3];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            Point3D next = start;
+            while (true)
+            {
+                (axis == 0 ? next.d_ : axis == 1 ? next.x_ : next.y_) += boxSize;
+                std::size_t index = isAvailable(next, boxSize);
+                if (index == nodes.size())
+                    break;
+                runs[axis].push_back(index);
+            }
+        }
+
+        int longest = 0;
+        for (int axis = 1; axis < 3; axis++)
+            if (runs[axis].size() > runs[longest].size())
+                longest = axis;
+
+        merged[j] = true;
+        for (auto index : runs[longest])
+            merged[index] = true;
+
+        int length = (int)(runs[longest].size() + 1) * boxSize;
+        boxes.push_back(std::make_pair(start, Point3D(
+            start.d_ + (longest == 0 ? length : boxSize),
+            start.x_ + (longest == 1 ? length : boxSize),
+            start.y_ + (longest == 2 ? length : boxSize))));
+    }
+
+    return boxes;
+}
+
+
+
+//visits the boxes of the list, which must outlive the source
+BoxSource listBoxes(const std::vector<Bounds2D>& boxes)
+{
+    return [&boxes](const BoxVisitor& visit) {
+        for (const auto& box : boxes)
+            visit(box);
+    };
+}
+
+
+
+//sorts the boxes by how many of their sides span more than one block: points, lines, planes and cubes
+std::vector<std::size_t> countBoxShapes(const BoxSource& boxes, std::size_t blockSize)
+{
+    std::vector<std::size_t> counts(4, 0);
+    const int block = (int)blockSize;
+    boxes([&](const Bounds2D& box) {
+        counts[(std::size_t)((box.second.d_ - box.first.d_ > block) + (box.second.x_ - box.first.x_ > block) +
+            (box.second.y_ - box.first.y_ > block))]++;
+    });
+    return counts;
+}
+
+
+
+//halves the volume along every axis, keeping a voxel where at least half of the eight it covers are inside
+Volume downsample(const Volume& volume)
+{
+    Volume half((volume.getHeight() + 1) / 2, (volume.getSize() + 1) / 2);
+    runInParallel(half.getHeight(), [&](std::size_t d) {
+        for (std::size_t x = 0; x < half.getSize(); x++)
+        {
+            for (std::size_t y = 0; y < half.getSize(); y++)
+            {
+                std::size_t inside = 0;
+                for (std::size_t j = 0; j < 8; j++)
+                {
+                    std::size_t fineD = 2 * d + (j & 1), fineX = 2 * x + (j >> 1 & 1), fineY = 2 * y + (j >> 2);
+                    if (fineD < volume.getHeight() && fineX < volume.getSize() && fineY < volume.getSize())
+                        inside += volume.get(fineD, fineX, fineY);
+                }
+
+                if (inside >= 4)
+                    half.set(d, x, y);
+            }
+        }
+    });
+
+    return half;
+}
+
+
+
+/*
+    Writes the coarser levels of detail next to the binary geometry, down to
+    levels - 1 halvings, and removes the file of the level after them so a
+    reader stops there. Each level keeps the full geometry's smallest box in
+    voxels, until a single downsampled voxel is already larger. Returns the
+    boxes written per level.
+*/
+std::vector<std::size_t> writeLevels(const Volume& cleaned, std::size_t levels, std::size_t minBoxSize)
+{
+    std::vector<std::size_t> boxCounts;
+    Volume level = cleaned;
+    std::size_t written = 1;
+    for (; written < levels && level.getSize() >= 2 * minBoxSize; written++)
+    {
+        level = downsample(level);
+        std::vector<Bounds2D> boxes = findCuboids(level, std::max(minBoxSize >> written, (std::size_t)1));
+        for (auto& box : boxes) //back to full-resolution voxels
+        {
+            box.first = Point3D(box.first.d_ << written, box.first.x_ << written, box.first.y_ << written);
+            box.second = Point3D(box.second.d_ << written, box.second.x_ << written, box.second.y_ << written);
+        }
+
+        writeBinaryGeometry(boxes, cleaned.getHeight(), cleaned.getSize(), getLevelFilename(written));
+        boxCounts.push_back(boxes.size());
+    }
+
+    std::remove(getLevelFilename(written).c_str());
+    return boxCounts;
+}
+
+
+
+void writeGeometry(const BoxSource& boxes, std::string filename)
+{
+    std::ofstream fout;
+    fout.open(filename, std::ofstream::out);
+
+    const int flag = 4; //every box is a solid cuboid
+    std::size_t written = 0;
+    boxes([&](const Bounds2D& box) {
+        fout << flag << " " << box.first.d_ <<
+            " " << box.first.x_ <<
+            " " << box.first.y_ <<
+            " " << box.second.d_ <<
+            " " << box.second.x_ <<
+            " " << box.second.y_ << "\n";
+        written++;
+    });
+
+    std::cout << "wrote " << written << " boxes, ";
+
+    fout.close();
+}
+
+
+
+//the same boxes in the binary form that the renderer maps straight into memory
+void writeBinaryGeometry(const std::vector<Bounds2D>& boxes, std::size_t height,
+    std::size_t size, std::string filename)
+{
+    writeBinaryGeometry(listBoxes(boxes), height, size, filename, boxes.size());
+}
+
+
+
+//the same, holding at most bufferBoxes of the records in memory at a time
+void writeBinaryGeometry(const BoxSource& boxes, std::size_t height,
+    std::size_t size, std::string filename, std::size_t bufferBoxes)
+{
+    auto records = [&](const RecordVisitor& visit) {
+        boxes([&](const Bounds2D& box) {
+            visit(BoxRecord{
+                (std::int16_t)box.first.d_, (std::int16_t)box.first.x_, (std::int16_t)box.first.y_,
+                (std::int16_t)box.second.d_, (std::int16_t)box.second.x_, (std::int16_t)box.second.y_});
+        });
+    };
+
+    if (!writeGeometryFile(filename, height, size, BRICK_SIZE, records, bufferBoxes))
+        std::cout << "unable to write \"" << filename << "\"! ";
+}
+
+
+
+//returns what is wrong with the boxes as a cover of the volume's full blocks, or nothing
+std::string checkCoverage(const Volume& cleaned, const std::vector<Bounds2D>& boxes, std::size_t blockSize)
+{
+    Volume covered(cleaned.getHeight(), cleaned.getSize());
+    std::size_t overlapping = 0, outside = 0, total = 0;
+    for (const auto& box : boxes)
+    {
+        for (int d = box.first.d_; d < box.second.d_; d++)
+        {
+            for (int x = box.first.x_; x < box.second.x_; x++)
+            {
+                for (int y = box.first.y_; y < box.second.y_; y++)
+                {
+                    overlapping += covered.get((std::size_t)d, (std::size_t)x, (std::size_t)y);
+                    outside += !cleaned.get((std::size_t)d, (std::size_t)x, (std::size_t)y);
+                    covered.set((std::size_t)d, (std::size_t)x, (std::size_t)y);
+                }
+            }
+        }
+        total += (std::size_t)((box.second.d_ - box.first.d_) * (box.second.x_ - box.first.x_) *
+            (box.second.y_ - box.first.y_));
+    }
+
+    std::size_t expected = findFullBlocks(cleaned, blockSize).count() * blockSize * blockSize * blockSize;
+
+    std::stringstream problems("");
+    if (overlapping > 0)
+        problems << overlapping << " voxels covered twice; ";
+    if (outside > 0)
+        problems << outside << " voxels covered outside the volume; ";
+    if (total - overlapping != expected)
+        problems << "cover " << total - overlapping << " voxels of " << expected << " in full blocks; ";
+    return problems.str();
+}
+
+
+
+//finds a voxel of the volume's first inside row, which after cleaning is in its only component
+bool findSeed(const Volume& volume, std::size_t& seedD, std::size_t& seedX, std::size_t& seedY)
+{
+    for (seedD = 0; seedD < volume.getHeight(); seedD++)
+        for (seedX = 0; seedX < volume.getSize(); seedX++)
+            for (std::size_t w = 0; w < volume.getRowWords(); w++)
+                if (volume.getWord(seedD, seedX, w) != 0)
+                {
+                    seedY = w * Volume::WORD_BITS + (std::size_t)__builtin_ctzll(volume.getWord(seedD, seedX, w));
+                    return true;
+                }
+
+    return false;
+}
+
+
+
+bool isSameVolume(const Volume& a, const Volume& b)
+{
+    for (std::size_t d = 0; d < a.getHeight(); d++)
+        for (std::size_t x = 0; x < a.getSize(); x++)
+            for (std::size_t w = 0; w < a.getRowWords(); w++)
+                if (a.getWord(d, x, w) != b.getWord(d, x, w))
+                    return false;
+    return true;
+}
@@ -0,0 +1,283 @@
+
+#include "SurfaceMesh.hpp"
+#include "Parallel.hpp"
+#include <fstream>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <cstring>
+
+
+//cell (cd, cx, cy) has the samples d in {cd - 1, cd}, x in {cx - 1, cx}, y in {cy - 1, cy}
+SurfaceMesh::SurfaceMesh(const Volume& volume) :
+    volume_(volume), height_(volume.getHeight()), size_(volume.getSize()),
+    cellWords_(volume.getSize() / Volume::WORD_BITS + 1)
+{
+    std::size_t slabCount = std::min(getThreadCount(), height_ + 1);
+    std::vector<std::size_t> slabs = splitEvenly(height_ + 1, slabCount);
+
+    std::vector<std::vector<std::uint32_t>> slabCells(slabCount);
+    rowStarts_.assign((height_ + 1) * (size_ + 1) + 1, 0);
+    runInParallel(slabCount, [&](std::size_t slab) {
+        findCells(slabs[slab], slabs[slab + 1], slabCells[slab]);
+    });
+
+    std::partial_sum(rowStarts_.begin(), rowStarts_.end(), rowStarts_.begin());
+    for (const auto& cells : slabCells)
+        cellYs_.insert(cellYs_.end(), cells.begin(), cells.end());
+
+    positions_.resize(cellYs_.size() * 3);
+    normals_.resize(cellYs_.size() * 3);
+    runInParallel(slabCount, [&](std::size_t slab) {
+        placeVertices(slabs[slab], slabs[slab + 1]);
+    });
+
+    std::vector<std::vector<std::uint32_t>> slabIndices(slabCount);
+    runInParallel(slabCount, [&](std::size_t slab) {
+        addFaces(slabs[slab], slabs[slab + 1], slabIndices[slab]);
+    });
+
+    for (const auto& indices : slabIndices)
+        indices_.insert(indices_.end(), indices.begin(), indices.end());
+}
+
+
+
+/*
+    Binary layout, native endianness:
+    "MBM1", uint32 vertex count, uint32 index count,
+    vertex count float triples of positions (d, x, y in voxels),
+    vertex count float triples of unit normals,
+    index count uint32 indices, three per counterclockwise triangle.
+*/
+void SurfaceMesh::write(std::string filename) const
+{
+    std::ofstream fout;
+    fout.open(filename, std::ofstream::out | std::ofstream::binary);
+
+    auto vertexCount = (std::uint32_t)cellYs_.size(), indexCount = (std::uint32_t)indices_.size();
+    fout.write("MBM1", 4);
+    fout.write(reinterpret_cast<const char*>(&vertexCount), sizeof(vertexCount));
+    fout.write(reinterpret_cast<const char*>(&indexCount), sizeof(indexCount));
+    fout.write(reinterpret_cast<const char*>(positions_.data()), (std::streamsize)(positions_.size() * sizeof(float)));
+    fout.write(reinterpret_cast<const char*>(normals_.data()), (std::streamsize)(normals_.size() * sizeof(float)));
+    fout.write(reinterpret_cast<const char*>(indices_.data()), (std::streamsize)(indices_.size() * sizeof(std::uint32_t)));
+
+    fout.close();
+}
+
+
+
+std::size_t SurfaceMesh::getVertexCount() const
+{
+    return cellYs_.size();
+}
+
+
+
+std::size_t SurfaceMesh::getTriangleCount() const
+{
+    return indices_.size() / 3;
+}
+
+
+
+//records the cells of layers [minCD, maxCD) that straddle the surface
+void SurfaceMesh::findCells(std::size_t minCD, std::size_t maxCD, std::vector<std::uint32_t>& cellYs)
+{
+    for (std::size_t cd = minCD; cd < maxCD; cd++)
+    {
+        for (std::size_t cx = 0; cx <= size_; cx++)
+        {
+            std::size_t count = 0;
+            Volume::Word previousAny = 0, previousAll = 0;
+            for (std::size_t w = 0; w < cellWords_; w++)
+            {
+                //combine the four sample rows, then each sample with the one before it
+                Volume::Word any = 0, all = ~(Volume::Word)0;
+                for (std::size_t j = 0; j < 4; j++)
+                {
+                    Volume::Word word = getSampleWord(cd - 1 + (j >> 1), cx - 1 + (j & 1), w);
+                    any |= word;
+                    all &= word;
+                }
+
+                Volume::Word cellAny = any | (any << 1) | (previousAny >> (Volume::WORD_BITS - 1));
+                Volume::Word cellAll = all & ((all << 1) | (previousAll >> (Volume::WORD_BITS - 1)));
+                previousAny = any, previousAll = all;
+
+                for (Volume::Word mixed = cellAny & ~cellAll; mixed != 0; mixed &= mixed - 1)
+                {
+                    cellYs.push_back((std::uint32_t)(w * Volume::WORD_BITS + (std::size_t)__builtin_ctzll(mixed)));
+                    count++;
+                }
+            }
+
+            rowStarts_[cd * (size_ + 1) + cx + 1] = count;
+        }
+    }
+}
+
+
+
+//puts each vertex at the mean of the crossings on its cell's edges, with the
+//normal pointing away from the inside samples
+void SurfaceMesh::placeVertices(std::size_t minCD, std::size_t maxCD)
+{
+    for (std::size_t cd = minCD; cd < maxCD; cd++)
+    {
+        for (std::size_t cx = 0; cx <= size_; cx++)
+        {
+            std::size_t row = cd * (size_ + 1) + cx;
+            for (std::size_t v = rowStarts_[row]; v < rowStarts_[row + 1]; v++)
+            {
+                std::size_t cy = cellYs_[v];
+                bool inside[8];
+                for (std::size_t j = 0; j < 8; j++)
+                    inside[j] = isInside((std::ptrdiff_t)(cd + (j >> 2)) - 1,
+                        (std::ptrdiff_t)(cx + ((j >> 1) & 1)) - 1, (std::ptrdiff_t)(cy + (j & 1)) - 1);
+
+                float sum[3] = {0, 0, 0}, gradient[3] = {0, 0, 0};
+                std::size_t crossings = 0;
+                for (std::size_t j = 0; j < 8; j++)
+                {
+                    for (std::size_t axis = 0; axis < 3; axis++)
+                    {
+                        std::size_t bit = (std::size_t)4 >> axis;
+                        if (inside[j])
+                            gradient[axis] += (j & bit) ? -1.0f : 1.0f;
+
+                        //each edge once, from its lower sample
+                        if ((j & bit) == 0 && inside[j] != inside[j | bit])
+                        {
+                            for (std::size_t other = 0; other < 3; other++)
+                                sum[other] += (((j >> (2 - other)) & 1) ? 0.5f : -0.5f);
+                            sum[axis] += 0.5f; //midway along the edge
+                            crossings++;
+                        }
+                    }
+                }
+
+                float length = std::sqrt(gradient[0] * gradient[0] +
+                    gradient[1] * gradient[1] + gradient[2] * gradient[2]);
+                const float center[3] = {(float)cd, (float)cx, (float)cy};
+                for (std::size_t axis = 0; axis < 3; axis++)
+                {
+                    positions_[v * 3 + axis] = center[axis] + sum[axis] / (float)crossings;
+                    normals_[v * 3 + axis] = length > 0 ? gradient[axis] / length : 0;
+                }
+            }
+        }
+    }
+}
+
+
+
+//adds the quads whose highest cell layer is in [minCD, maxCD)
+void SurfaceMesh::addFaces(std::size_t minCD, std::size_t maxCD, std::vector<std::uint32_t>& indices) const
+{
+    for (std::size_t cd = minCD; cd < maxCD; cd++)
+    {
+        for (std::size_t cx = 0; cx <= size_; cx++)
+        {
+            Volume::Word previous = 0;
+            for (std::size_t w = 0; w < cellWords_; w++)
+            {
+                Volume::Word lower = getSampleWord(cd - 1, cx - 1, w);
+                Volume::Word below = getSampleWord(cd - 1, cx, w);
+                Volume::Word here = getSampleWord(cd, cx, w);
+
+                //samples (cd - 1, cx) and (cd, cx) differ along d
+                if (cx < size_)
+                    for (Volume::Word edges = below ^ here; edges != 0; edges &= edges - 1)
+                    {
+                        std::size_t y = w * Volume::WORD_BITS + (std::size_t)__builtin_ctzll(edges);
+                        addQuad(cd, cx, y, 0, (below >> (y % Volume::WORD_BITS)) & 1, indices);
+                    }
+
+                //samples (cd - 1, cx - 1) and (cd - 1, cx) differ along x
+                if (cd > 0)
+                    for (Volume::Word edges = lower ^ below; edges != 0; edges &= edges - 1)
+                    {
+                        std::size_t y = w * Volume::WORD_BITS + (std::size_t)__builtin_ctzll(edges);
+                        addQuad(cd, cx, y, 1, (lower >> (y % Volume::WORD_BITS)) & 1, indices);
+                    }
+
+                //samples (cd - 1, cx, cy - 1) and (cd - 1, cx, cy) differ along y
+                if (cd > 0 && cx < size_)
+                {
+                    Volume::Word shifted = (below << 1) | (previous >> (Volume::WORD_BITS - 1));
+                    for (Volume::Word edges = below ^ shifted; edges != 0; edges &= edges - 1)
+                    {
+                        std::size_t cy = w * Volume::WORD_BITS + (std::size_t)__builtin_ctzll(edges);
+                        addQuad(cd, cx, cy, 2, (shifted >> (cy % Volume::WORD_BITS)) & 1, indices);
+                    }
+                }
+                previous = below;
+            }
+        }
+    }
+}
+
+
+
+/*
+    Adds the two triangles around an edge between two samples that differ
+    along the axis (0 = d, 1 = x, 2 = y). Along the axis, all four cells
+    around the edge share the given coordinate. Along x and y they take the
+    given one and the next, and along d the given one and the previous,
+    since faces are split among slabs by their highest cell layer.
+    facesUp is true when the lower of the two samples is the inside one.
+*/
+void SurfaceMesh::addQuad(std::size_t cd, std::size_t cx, std::size_t cy, int axis,
+    bool facesUp, std::vector<std::uint32_t>& indices) const
+{
+    std::uint32_t corners[4];
+    for (std::size_t j = 0; j < 4; j++)
+    {
+        //walk the quad counterclockwise as seen from the axis' positive side
+        std::size_t b = (j == 1 || j == 2) ? 1 : 0, c = (j >= 2) ? 1 : 0;
+        if (axis == 0) //b = x, c = y
+            corners[j] = findVertex(cd, cx + b, cy + c);
+        else if (axis == 1) //b = y, c = d
+            corners[j] = findVertex(cd - 1 + c, cx, cy + b);
+        else //b = d, c = x
+            corners[j] = findVertex(cd - 1 + b, cx + c, cy);
+    }
+
+    if (!facesUp)
+        std::swap(corners[1], corners[3]);
+
+    indices.insert(indices.end(), {corners[0], corners[1], corners[2]});
+    indices.insert(indices.end(), {corners[0], corners[2], corners[3]});
+}
+
+
+
+std::uint32_t SurfaceMesh::findVertex(std::size_t cd, std::size_t cx, std::size_t cy) const
+{
+    std::size_t row = cd * (size_ + 1) + cx;
+    auto begin = cellYs_.begin() + (std::ptrdiff_t)rowStarts_[row];
+    auto end = cellYs_.begin() + (std::ptrdiff_t)rowStarts_[row + 1];
+    return (std::uint32_t)(std::lower_bound(begin, end, (std::uint32_t)cy) - cellYs_.begin());
+}
+
+
+
+//returns a word of sample row (d, x), which is empty outside of the volume
+Volume::Word SurfaceMesh::getSampleWord(std::size_t d, std::size_t x, std::size_t w) const
+{
+    if (d >= height_ || x >= size_ || w >= volume_.getRowWords())
+        return 0; //also catches d or x of -1, which wrap around
+    return volume_.getWord(d, x, w);
+}
+
+
+
+bool SurfaceMesh::isInside(std::ptrdiff_t d, std::ptrdiff_t x, std::ptrdiff_t y) const
+{
+    if (d < 0 || x < 0 || y < 0 || d >= (std::ptrdiff_t)height_ ||
+        x >= (std::ptrdiff_t)size_ || y >= (std::ptrdiff_t)size_)
+        return false;
+    return volume_.get((std::size_t)d, (std::size_t)x, (std::size_t)y);
+}
@@ -0,0 +1,50 @@
+
+#ifndef SURFACE_MESH
+#define SURFACE_MESH
+
+/**
+    A SurfaceMesh is the boundary of a Volume as an indexed triangle mesh,
+    extracted with surface nets. Voxels are the samples; every cell of
+    eight neighboring samples that has both inside and outside samples gets
+    one vertex, and every pair of neighboring samples that differ gets a
+    quad joining the four cells around them. The volume is treated as
+    outside beyond its edges, so the mesh is closed.
+
+    Vertices are numbered in d, x, y order of their cells. Slabs of cell
+    layers are handled by separate threads, and since a slab can look up
+    any cell's vertex once all vertices are placed, faces across slab
+    boundaries share vertices without further stitching.
+**/
+
+#include "Volume.hpp"
+#include <string>
+
+class SurfaceMesh
+{
+    public:
+        SurfaceMesh(const Volume& volume);
+
+        void write(std::string filename) const;
+        std::size_t getVertexCount() const;
+        std::size_t getTriangleCount() const;
+
+    private:
+        void findCells(std::size_t minCD, std::size_t maxCD, std::vector<std::uint32_t>& cellYs);
+        void placeVertices(std::size_t minCD, std::size_t maxCD);
+        void addFaces(std::size_t minCD, std::size_t maxCD, std::vector<std::uint32_t>& indices) const;
+        void addQuad(std::size_t cd, std::size_t cx, std::size_t cy, int axis,
+            bool facesUp, std::vector<std::uint32_t>& indices) const;
+        std::uint32_t findVertex(std::size_t cd, std::size_t cx, std::size_t cy) const;
+        Volume::Word getSampleWord(std::size_t d, std::size_t x, std::size_t w) const;
+        bool isInside(std::ptrdiff_t d, std::ptrdiff_t x, std::ptrdiff_t y) const;
+
+    private:
+        const Volume& volume_;
+        std::size_t height_, size_, cellWords_;
+        std::vector<std::size_t> rowStarts_; //first vertex of each (cd, cx) cell row
+        std::vector<std::uint32_t> cellYs_; //cy of each vertex's cell
+        std::vector<float> positions_, normals_; //three per vertex, in d, x, y order
+        std::vector<std::uint32_t> indices_; //three per triangle
+};
+
+#endif
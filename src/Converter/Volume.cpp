@@ -0,0 +1,124 @@
+
+#include "Volume.hpp"
+#include <algorithm>
+
+
+#ifdef MORTON_VOLUME
+
+namespace
+{
+    std::size_t getBitCount(std::size_t extent)
+    {
+        std::size_t bits = 0;
+        while (((std::size_t)1 << bits) < extent)
+            bits++;
+        return bits;
+    }
+
+
+
+    //returns each value below extent with its bits moved to the given positions
+    std::vector<std::size_t> spreadBits(std::size_t extent, const std::vector<std::size_t>& positions)
+    {
+        std::vector<std::size_t> spread(extent, 0);
+        for (std::size_t value = 0; value < extent; value++)
+            for (std::size_t bit = 0; bit < positions.size(); bit++)
+                if ((value >> bit) & 1)
+                    spread[value] |= (std::size_t)1 << positions[bit];
+        return spread;
+    }
+}
+
+
+
+Volume::Volume(std::size_t height, std::size_t size) :
+    height_(height), size_(size), rowWords_((size + WORD_BITS - 1) / WORD_BITS)
+{
+    //deal out the index bits from the lowest up, w then x then d, skipping axes that run out
+    std::size_t bits[3] = { getBitCount(rowWords_), getBitCount(size_), getBitCount(height_) };
+    std::vector<std::size_t> positions[3];
+    std::size_t next = 0;
+    for (std::size_t round = 0; round < std::max(bits[0], std::max(bits[1], bits[2])); round++)
+        for (std::size_t axis = 0; axis < 3; axis++)
+            if (round < bits[axis])
+                positions[axis].push_back(next++);
+
+    spreadW_ = spreadBits(rowWords_, positions[0]);
+    spreadX_ = spreadBits(size_, positions[1]);
+    spreadD_ = spreadBits(height_, positions[2]);
+    words_.resize(height_ > 0 && size_ > 0 ? (std::size_t)1 << next : 0, 0);
+}
+
+#else
+
+Volume::Volume(std::size_t height, std::size_t size) :
+    height_(height), size_(size), rowWords_((size + WORD_BITS - 1) / WORD_BITS),
+    bricksX_((size + BRICK_WORDS - 1) / BRICK_WORDS),
+    bricksW_((rowWords_ + BRICK_WORDS - 1) / BRICK_WORDS)
+{
+    std::size_t bricksD = (height + BRICK_WORDS - 1) / BRICK_WORDS;
+    words_.resize(bricksD * bricksX_ * bricksW_ * BRICK_WORDS * BRICK_WORDS * BRICK_WORDS, 0);
+}
+
+#endif
+
+
+
+//marks voxels y through y + length - 1 of the row as inside
+void Volume::setRun(std::size_t d, std::size_t x, std::size_t y, std::size_t length)
+{
+    std::size_t end = std::min(y + length, size_);
+    while (y < end)
+    {
+        std::size_t bit = y % WORD_BITS;
+        std::size_t span = std::min(WORD_BITS - bit, end - y);
+        Word mask = span == WORD_BITS ? ~(Word)0 : (((Word)1 << span) - 1) << bit;
+        getWord(d, x, y / WORD_BITS) |= mask;
+        y += span;
+    }
+}
+
+
+
+std::size_t Volume::getHeight() const
+{
+    return height_;
+}
+
+
+
+std::size_t Volume::getSize() const
+{
+    return size_;
+}
+
+
+
+std::size_t Volume::getRowWords() const
+{
+    return rowWords_;
+}
+
+
+
+//number of voxels inside
+std::size_t Volume::count() const
+{
+    std::size_t total = 0;
+    for (auto word : words_)
+        total += (std::size_t)__builtin_popcountll(word);
+    return total;
+}
+
+
+
+//memory held by the words and tables
+std::size_t Volume::getBytes() const
+{
+#ifdef MORTON_VOLUME
+    return words_.capacity() * sizeof(Word) +
+        (spreadD_.capacity() + spreadX_.capacity() + spreadW_.capacity()) * sizeof(std::size_t);
+#else
+    return words_.capacity() * sizeof(Word);
+#endif
+}
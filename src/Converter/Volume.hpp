@@ -0,0 +1,109 @@
+
+#ifndef VOLUME
+#define VOLUME
+
+/**
+    A Volume records which voxels of a height x size x size grid are inside
+    the fractal, using one bit per voxel. Each 64-bit word holds 64
+    consecutive y voxels of a single (d, x) row, and the words are grouped
+    into bricks of 8 x 8 x 8 words along d, x and y. A step in any direction
+    therefore usually stays within the same 4 KB brick, unlike the nested
+    vectors the converter used to hold its voxels in. Bits beyond the end of
+    a row are always zero.
+
+    Built with MORTON_VOLUME, the words are instead laid out in Z-order:
+    the bits of the d, x and word coordinates are interleaved, each axis
+    padded to a power of two, so that neighbors stay close at every scale
+    rather than only within a brick. Each coordinate's spread bits come
+    from a small table, and a word's index is the three entries or'ed.
+**/
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+class Volume
+{
+    public:
+        typedef std::uint64_t Word;
+        static const std::size_t WORD_BITS = 64;
+        static const std::size_t BRICK_WORDS = 8; //per side of a brick
+
+        Volume(std::size_t height, std::size_t size);
+
+        bool get(std::size_t d, std::size_t x, std::size_t y) const;
+        void set(std::size_t d, std::size_t x, std::size_t y);
+        void reset(std::size_t d, std::size_t x, std::size_t y);
+        void setRun(std::size_t d, std::size_t x, std::size_t y, std::size_t length);
+
+        Word getWord(std::size_t d, std::size_t x, std::size_t w) const;
+        Word& getWord(std::size_t d, std::size_t x, std::size_t w);
+
+        std::size_t getHeight() const;
+        std::size_t getSize() const;
+        std::size_t getRowWords() const;
+        std::size_t count() const;
+        std::size_t getBytes() const;
+
+    private:
+        std::size_t getIndex(std::size_t d, std::size_t x, std::size_t w) const;
+
+    private:
+        std::size_t height_, size_, rowWords_;
+#ifdef MORTON_VOLUME
+        std::vector<std::size_t> spreadD_, spreadX_, spreadW_; //coordinates with their bits at Morton positions
+#else
+        std::size_t bricksX_, bricksW_;
+#endif
+        std::vector<Word> words_;
+};
+
+
+
+inline std::size_t Volume::getIndex(std::size_t d, std::size_t x, std::size_t w) const
+{
+#ifdef MORTON_VOLUME
+    return spreadD_[d] | spreadX_[x] | spreadW_[w];
+#else
+    std::size_t brick = ((d / BRICK_WORDS) * bricksX_ + x / BRICK_WORDS) * bricksW_ + w / BRICK_WORDS;
+    std::size_t local = ((d % BRICK_WORDS) * BRICK_WORDS + x % BRICK_WORDS) * BRICK_WORDS + w % BRICK_WORDS;
+    return brick * BRICK_WORDS * BRICK_WORDS * BRICK_WORDS + local;
+#endif
+}
+
+
+
+inline Volume::Word Volume::getWord(std::size_t d, std::size_t x, std::size_t w) const
+{
+    return words_[getIndex(d, x, w)];
+}
+
+
+
+inline Volume::Word& Volume::getWord(std::size_t d, std::size_t x, std::size_t w)
+{
+    return words_[getIndex(d, x, w)];
+}
+
+
+
+inline bool Volume::get(std::size_t d, std::size_t x, std::size_t y) const
+{
+    return (getWord(d, x, y / WORD_BITS) >> (y % WORD_BITS)) & 1;
+}
+
+
+
+inline void Volume::set(std::size_t d, std::size_t x, std::size_t y)
+{
+    getWord(d, x, y / WORD_BITS) |= (Word)1 << (y % WORD_BITS);
+}
+
+
+
+inline void Volume::reset(std::size_t d, std::size_t x, std::size_t y)
+{
+    getWord(d, x, y / WORD_BITS) &= ~((Word)1 << (y % WORD_BITS));
+}
+
+#endif
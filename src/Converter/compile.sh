@@ -1,6 +1,6 @@
 #!/bin/sh
 #use OpenMPI-GCC-4.8
-if (g++ -O3 --std=c++11 main.cpp -o converter) then
+if (g++ -O3 --std=c++11 -pthread -I../Shared main.cpp Stages.cpp Volume.cpp Octree.cpp Greedy.cpp SurfaceMesh.cpp SlabStream.cpp Components.cpp Parallel.cpp SliceReader.cpp IntervalVolume.cpp ConversionCache.cpp CacheMisses.cpp StageLog.cpp DistanceField.cpp -o converter) then
     echo "Compilation success."
     exit 0
 else
@@ -1,399 +1,364 @@
 
 #include "main.hpp"
-#include <fstream>
+#include "Components.hpp"
+#include "Parallel.hpp"
+#include "Octree.hpp"
+#include "Greedy.hpp"
+#include "SurfaceMesh.hpp"
+#include "SlabStream.hpp"
+#include "SliceReader.hpp"
+#include "IntervalVolume.hpp"
+#include "ConversionCache.hpp"
+#include "CacheMisses.hpp"
+#include "StageLog.hpp"
+#include "DistanceField.hpp"
 #include <sstream>
-#include <iterator>
+#include <stdexcept>
+#include <memory>
 #include <algorithm>
 #include <iostream>
+#include <cstdlib>
+#include <cstdio>
 
 
 const std::size_t SIZE = 1024;
-const std::size_t HEIGHT = 1024;
+const std::size_t HEIGHT = 1024; //slices of a stack that has no manifest
+const std::size_t MIN_BOX_SIZE = 4; //smaller boxes are left out of the geometry
+const char* const CACHE_FILE = "geometry.cache";
+const char* const LOG_FILE = "stages.log"; //one JSON object per stage
+const std::size_t LOD_LEVELS = 4; //full resolution and three halvings, for the renderer
+const std::size_t SDF_BAND = 8, MAX_SDF_BAND = 63; //in voxels, the most that keeps 0 free in the file
 
 
 int main(int argc, char** argv)
 {
+    StageLog log(LOG_FILE);
+    auto logBoxes = [&](const BoxSource& boxes) {
+        std::vector<std::size_t> shapes = countBoxShapes(boxes, MIN_BOX_SIZE);
+        log.note("boxes", shapes[0] + shapes[1] + shapes[2] + shapes[3]);
+        log.note("cubes", shapes[3]);
+        log.note("planes", shapes[2]);
+        log.note("lines", shapes[1]);
+        log.note("points", shapes[0]);
+        std::cout << shapes[3] << " cubes, " << shapes[2] << " planes, " <<
+            shapes[1] << " lines and " << shapes[0] << " points, ";
+    };
+
     std::cout << "Reading files... ";
-    std::vector<std::string> files;
-    for (std::size_t j = 1; j <= HEIGHT; j++)
+    log.begin("check", 0);
+    std::vector<std::string> files = readManifest("slices.dat");
+    if (files.empty()) //generator predates the manifest, so assume uniform d
     {
-        std::stringstream ss("");
-        //ss << "test" << j << ".txt";
-        ss << "multibrot,d=" << (j / (float)32 + 1) << ".dat";
-        files.push_back(ss.str());
+        for (std::size_t j = 1; j <= HEIGHT; j++)
+        {
+            std::stringstream ss("");
+            //ss << "test" << j << ".txt";
+            ss << "multibrot,d=" << (j / (float)32 + 1) << ".dat";
+            files.push_back(ss.str());
+        }
     }
-    std::cout << "done." << std::endl;
 
-    Matrix3D matrix = readMatrix(files);
-
-    std::cout << "Remove islands... ";
-    std::cout.flush();
-    removeIslands(matrix, HEIGHT / 2, SIZE / 2, SIZE / 2);
+    //the manifest may list any number of slices, which sets the height of the volume
+    const std::size_t height = files.size();
+    const std::uint64_t voxels = (std::uint64_t)height * SIZE * SIZE;
+    std::vector<std::string> problems = findBadSlices(files, SIZE);
+    if (!problems.empty())
+    {
+        std::cout << std::endl;
+        for (const auto& problem : problems)
+            std::cout << problem << std::endl;
+        return EXIT_FAILURE;
+    }
+    log.note("slices", files.size());
+    log.end();
     std::cout << "done." << std::endl;
-    std::cout.flush();
 
-    std::cout << "Compressing. Looking for boxes of size ";
-    std::size_t boxSize = 1;
-    while (compress(matrix, boxSize))
-        boxSize *= 2;
-    std::cout << "done." << std::endl;
-/*
-    for (std::size_t d = 0; d < HEIGHT; d++)
+    setThreadCount(getOption(argc, argv, "--threads", 0));
+    std::size_t minSize = getOption(argc, argv, "--min-component-size", 0);
+    if (hasFlag(argc, argv, "--stream"))
     {
-        for (std::size_t x = 0; x < SIZE; x++)
+        for (const char* flag : { "--mesh", "--seed-fill", "--sdf", "--intervals" })
         {
-            for (std::size_t y = 0; y < SIZE; y++)
-                std::cout << matrix[d][x][y] << " ";
-            std::cout << std::endl;
+            if (hasFlag(argc, argv, flag))
+            {
+                std::cout << flag << " needs the whole volume and cannot be combined with --stream!" << std::endl;
+                return EXIT_FAILURE;
+            }
         }
-        std::cout << std::endl << std::endl;
-    }*/
 
-    std::cout << "Calculating geometry, ";
-    writeGeometry(matrix, std::string("geometry.dat"));
-    std::cout << "finished." << std::endl;
+        //the slabs are sized by what they measurably take, in MB
+        std::size_t budget = (std::size_t)getOption(argc, argv, "--memory-budget", 1024) << 20;
+        std::cout << "Streaming in " << (budget >> 20) << " MB." << std::endl;
 
-    std::cout << "Program complete." << std::endl;
-
-    return EXIT_SUCCESS;
-}
-
-
-
-Matrix3D readMatrix(std::vector<std::string>& filenames)
-{
-    Matrix3D matrix;
-
-    std::string line;
-    for (const auto &filename : filenames)
-    {
-        std::ifstream file;
-        file.open(filename, std::ifstream::in);
-        if (file.fail())
-            std::cout << "Unable to open \"" << filename << "\"!" << std::endl;
-
-        std::vector<std::vector<int>> allIntegers;
-        while (getline(file, line))
+        SlabStream stream(files, SIZE, height, MIN_BOX_SIZE, hasFlag(argc, argv, "--greedy"));
+        stream.setMemoryBudget(budget);
+        log.begin("stream", voxels);
+        try
         {
-            std::istringstream is(line);
-            allIntegers.push_back(
-                std::vector<int>(std::istream_iterator<int>(is),
-                std::istream_iterator<int>()
-            ));
+            stream.run();
         }
-
-        file.close();
-        Matrix2D plane;
-
-        for (std::size_t y = 0; y < SIZE; y++)
+        catch (const std::runtime_error& error)
         {
-            bool state = false;
-            std::vector<short> row;
-            for (std::size_t j = 0; j < allIntegers[y].size(); j++)
-            {
-                row.insert(row.end(), (std::size_t)allIntegers[y][j], state ? 1 : 0);
-                state = !state;
-            }
-
-            plane.push_back(row);
+            std::cout << error.what() << std::endl;
+            return EXIT_FAILURE;
         }
 
-        matrix.push_back(plane);
+        const std::vector<Component>& components = stream.getComponents();
+        writeComponents(components, "components.dat");
+        std::vector<bool> kept = selectComponents(components, minSize);
+        std::cout << "Found " << components.size() << " components, kept " <<
+            std::count(kept.begin(), kept.end(), true) << "." << std::endl;
+        log.note("slabs", stream.getSlabCount());
+        log.note("peak_bytes", stream.getPeakBytes());
+        log.note("components", components.size());
+        log.end();
+
+        BoxSource boxes = stream.getKeptBoxes(kept);
+        std::cout << "Calculating geometry, ";
+        log.begin("write", 0);
+        logBoxes(boxes);
+        writeGeometry(boxes, std::string("geometry.dat"));
+        writeBinaryGeometry(boxes, height, SIZE, std::string("geometry.bin"), budget / sizeof(BoxRecord));
+        std::remove(getLevelFilename(1).c_str()); //no coarser levels without the whole volume
+        log.end();
+        std::cout << "finished." << std::endl;
+
+        std::cout << "Program complete." << std::endl;
+        return EXIT_SUCCESS;
     }
 
-    return matrix;
-}
-
-
-
-void removeIslands(Matrix3D& matrix, std::size_t startD, std::size_t startX, std::size_t startY)
-{
-    if (matrix[startD][startX][startY] == 0)
-        std::cout << "WARNING: start position is not in set!" << std::endl;
-    matrix[startD][startX][startY] = -1;
-
-    bool expanded;
-    do
+    if (hasFlag(argc, argv, "--intervals"))
     {
-        expanded = false;
-
-        for (std::size_t d = 0; d < HEIGHT; d++)
+        std::cout << "Loading runs... ";
+        std::cout.flush();
+        IntervalVolume intervals(0, SIZE, std::vector<IntervalVolume::Row>());
+        log.begin("load", voxels);
+        try
         {
-            for (std::size_t x = 0; x < SIZE; x++)
-            {
-                for (std::size_t y = 0; y < SIZE; y++)
-                {
-                    if (matrix[d][x][y] < 0) //if already marked
-                    {
-                        //check neighbors are inside set, if so mark them
-
-                        if (d > 0 && matrix[d - 1][x][y] > 0)
-                        {
-                            matrix[d - 1][x][y] = -1;
-                            expanded = true;
-                        }
-
-                        if (d + 1 < HEIGHT && matrix[d + 1][x][y] > 0)
-                        {
-                            matrix[d + 1][x][y] = -1;
-                            expanded = true;
-                        }
-
-                        if (x > 0 && matrix[d][x - 1][y] > 0)
-                        {
-                            matrix[d][x - 1][y] = -1;
-                            expanded = true;
-                        }
-
-                        if (x + 1 < SIZE && matrix[d][x + 1][y] > 0)
-                        {
-                            matrix[d][x + 1][y] = -1;
-                            expanded = true;
-                        }
-
-                        if (y > 0 && matrix[d][x][y - 1] > 0)
-                        {
-                            matrix[d][x][y - 1] = -1;
-                            expanded = true;
-                        }
-
-                        if (y + 1 < SIZE && matrix[d][x][y + 1] > 0)
-                        {
-                            matrix[d][x][y + 1] = -1;
-                            expanded = true;
-                        }
-                    }
-                }
-            }
+            intervals = readIntervals(files, SIZE);
         }
+        catch (const std::runtime_error& error)
+        {
+            std::cout << std::endl << error.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::cout << intervals.getRunCount() << " runs, " << intervals.count() << " voxels inside." << std::endl;
+        log.note("runs", intervals.getRunCount());
+        log.end();
 
-    } while (expanded);
-
-    for (std::size_t d = 0; d < HEIGHT; d++)
-        for (std::size_t x = 0; x < SIZE; x++)
-            for (std::size_t y = 0; y < SIZE; y++)
-                matrix[d][x][y] = matrix[d][x][y] < 0 ? 1 : 0;
-                //all marked are good, otherwise remove
-}
-
-
-
-bool compress(Matrix3D& matrix, std::size_t lookingFor)
-{
-    std::cout << lookingFor << " ";
-    auto newSize = lookingFor * 2;
-    bool found = false;
+        std::cout << "Labelling components... ";
+        std::cout.flush();
+        log.begin("labels", voxels);
+        const std::vector<Component>& components = intervals.findComponents();
+        writeComponents(components, "components.dat");
+        std::cout << "found " << components.size() << ". ";
+
+        std::vector<bool> kept = selectComponents(components, minSize);
+        std::cout << "Kept " << std::count(kept.begin(), kept.end(), true) << ", largest has " <<
+            (components.empty() ? 0 : components[0].voxels_) << " voxels." << std::endl;
+        intervals.keep(kept);
+        log.note("components", components.size());
+        log.end();
+
+        std::cout << "Growing cuboids... ";
+        std::cout.flush();
+        log.begin("cuboids", voxels);
+        std::vector<Bounds2D> boxes = intervals.findCuboids(MIN_BOX_SIZE);
+        log.end();
+        std::cout << "done." << std::endl;
+
+        std::cout << "Calculating geometry, ";
+        log.begin("write", 0);
+        logBoxes(listBoxes(boxes));
+        writeGeometry(listBoxes(boxes), std::string("geometry.dat"));
+        writeBinaryGeometry(boxes, height, SIZE, std::string("geometry.bin"));
+        std::remove(getLevelFilename(1).c_str()); //no coarser levels without the whole volume
+        log.end();
+        std::cout << "finished." << std::endl;
+
+        std::cout << "Program complete." << std::endl;
+        return EXIT_SUCCESS;
+    }
 
-    for (std::size_t d = 0; d <= HEIGHT - newSize; d += newSize)
+    //the cache only knows cuboids, which never cross a slab and so can be patched
+    const bool incremental = hasFlag(argc, argv, "--incremental");
+    std::unique_ptr<ConversionCache> cache;
+    Volume volume(0, SIZE);
+    try
     {
-        for (std::size_t x = 0; x <= SIZE - newSize; x += newSize)
+        std::cout << "Loading slices... ";
+        std::cout.flush();
+        log.begin("load", voxels);
+        if (incremental)
         {
-            for (std::size_t y = 0; y <= SIZE - newSize; y += newSize)
-            {
-                if (
-                (short)lookingFor == matrix[d][x][y] && //current cell
-                (short)lookingFor == matrix[d][x + lookingFor][y] && //current layer
-                (short)lookingFor == matrix[d][x + lookingFor][y + lookingFor] &&
-                (short)lookingFor == matrix[d][x][y + lookingFor] &&
-
-                (short)lookingFor == matrix[d + lookingFor][x][y] && //next layer
-                (short)lookingFor == matrix[d + lookingFor][x + lookingFor][y] &&
-                (short)lookingFor == matrix[d + lookingFor][x + lookingFor][y + lookingFor] &&
-                (short)lookingFor == matrix[d + lookingFor][x][y + lookingFor]
-                )
-                {
-                    found = true;
-                    for (std::size_t q = 0; q < newSize; q++)
-                        for (std::size_t r = 0; r < newSize; r++)
-                            for (std::size_t s = 0; s < newSize; s++)
-                                matrix[d + q][x + r][y + s] = (short)newSize;
-                }
-            }
+            cache.reset(new ConversionCache(height, SIZE, MIN_BOX_SIZE));
+            cache->read(CACHE_FILE);
+            std::vector<std::uint64_t> hashes = hashSlices(files);
+            std::vector<std::size_t> changed = cache->findChangedSlices(hashes);
+            readSlices(files, changed, cache->getVolume());
+            cache->setSliceHashes(hashes);
+            volume = cache->getVolume();
+            std::cout << changed.size() << " of " << files.size() << " changed, ";
+            log.note("changed_slices", changed.size());
         }
+        else
+            volume = readMatrix(files, SIZE);
+        std::cout << volume.count() << " voxels inside." << std::endl;
+        log.note("inside", volume.count());
+        log.end();
     }
-
-    return found;
-}
-
-
-
-void writeGeometry(Matrix3D& matrix, std::string filename)
-{
-    std::ofstream fout;
-    fout.open(filename, std::ofstream::out);
-
-    std::cout << "eliminating boxes of size ";
-
-    unsigned int pointCount = 0, lineCount = 0, planeCount = 0, cubeCount = 0;
-    for (short boxSize = 4; boxSize <= (short)std::min(SIZE, HEIGHT); boxSize *= 2)
+    catch (const std::runtime_error& error)
     {
-        std::cout << boxSize << " ";
-        std::cout.flush();
+        std::cout << std::endl << error.what() << std::endl;
+        return EXIT_FAILURE;
+    }
 
-        Point3D startPoint;
-        while (true) //eliminate all boxes
+    //the passes over the volume, whose misses depend on its layout
+    CacheMissCounter misses;
+    auto reportMisses = [&]() {
+        std::uint64_t count = misses.stop();
+        if (hasFlag(argc, argv, "--cache-misses"))
+            std::cout << "Cache misses in the volume passes: " <<
+                (misses.isAvailable() ? std::to_string(count) : "unavailable") << "." << std::endl;
+    };
+    misses.start();
+
+    //labels are 32 bits, which a noisy stack can run out of
+    try
+    {
+        if (hasFlag(argc, argv, "--seed-fill"))
         {
-            startPoint = getPointOf(matrix, boxSize);
-            //std::cout << "(" << startPoint.d_ << "," << startPoint.x_ << "," << startPoint.y_ << ")" << std::endl;
-            if (startPoint.d_ < 0 || startPoint.x_ < 0 || startPoint.y_ < 0)
-                break; //box not found
-
-            int flag = 0;
-
-            Bounds2D bounds = eliminateBoxOf(matrix, startPoint);
-/*
-            for (std::size_t d = 0; d < HEIGHT; d++)
-            {
-                for (std::size_t x = 0; x < SIZE; x++)
-                {
-                    for (std::size_t y = 0; y < SIZE; y++)
-                        std::cout << matrix[d][x][y] << " ";
-                    std::cout << std::endl;
-                }
-                std::cout << std::endl << std::endl;
-            }
-*/
-            if (boxSize == 1) //dealing with points
-            {
-                auto diffD = bounds.second.d_ - bounds.first.d_;
-                auto diffX = bounds.second.x_ - bounds.first.x_;
-                auto diffY = bounds.second.y_ - bounds.first.y_;
-
-                std::vector<int> sizes{diffD, diffX, diffY};
-                std::sort(sizes.begin(), sizes.end());
-
-                //smallest, middle, largest
-
-                if (sizes[2] == 1)
-                { //know that sizes[0] == sizes[1] == 1, so clearly a point
-                    pointCount++;
-                    flag = 1;
-                }
-                else if (sizes[1] == 1)
-                { //know that sizes[2] is the only one > 1
-                    lineCount++;
-                    flag = 2;
-                }
-                else if (sizes[1] == 1)
-                { //we know that sizes[1] > 1 && sizes[2] > 1, so a plane
-                    planeCount++;
-                    flag = 3;
-                }
-                else
-                { //know all three are > 0, so clearly a cube
-                    cubeCount++;
-                    flag = 4;
-                    std::cout << "Actually executed!" << std::endl;
-                    std::cout << flag << " " << bounds.first.d_ <<
-                        " " << bounds.first.x_ <<
-                        " " << bounds.first.y_ <<
-                        " " << bounds.second.d_ <<
-                        " " << bounds.second.x_ <<
-                        " " << bounds.second.y_ << std::endl;
-                }
-            }
-            else //dealing with squares
-            {
-                cubeCount++;
-                flag = 4;
-            }
+            std::cout << "Remove islands... ";
+            std::cout.flush();
+            log.begin("seed_fill", voxels);
+            std::size_t iterations = removeIslands(volume, height / 2, SIZE / 2, SIZE / 2);
+            log.note("iterations", iterations);
+            log.end();
+            std::cout << "done after " << iterations << " rows." << std::endl;
+            std::cout.flush();
+        }
+        else
+        {
+            std::cout << "Labelling components... ";
+            std::cout.flush();
+            log.begin("labels", voxels, 4); //the loops of ComponentLabels and its keep
+            ComponentLabels labels(volume);
+            const std::vector<Component>& components = labels.getComponents();
+            writeComponents(components, "components.dat");
+            std::cout << "found " << components.size() << ". ";
+
+            std::vector<bool> kept = selectComponents(components, minSize);
+            labels.keep(volume, kept);
+            log.note("components", components.size());
+            log.end();
+            std::cout << "Kept " << std::count(kept.begin(), kept.end(), true) << ", largest has " <<
+                (components.empty() ? 0 : components[0].voxels_) << " voxels." << std::endl;
+        }
 
-            fout << flag << " " << bounds.first.d_ <<
-                " " << bounds.first.x_ <<
-                " " << bounds.first.y_ <<
-                " " << bounds.second.d_ <<
-                " " << bounds.second.x_ <<
-                " " << bounds.second.y_ << std::endl;
+        if (!hasFlag(argc, argv, "--keep-cavities"))
+        {
+            std::cout << "Filling cavities... ";
+            std::cout.flush();
+            log.begin("cavities", voxels, 6); //the complement, its labels and keep, then the union
+            std::size_t filled = fillCavities(volume);
+            log.note("filled", filled);
+            log.end();
+            std::cout << filled << " voxels." << std::endl;
         }
     }
+    catch (const std::runtime_error& error)
+    {
+        std::cout << std::endl << error.what() << std::endl;
+        return EXIT_FAILURE;
+    }
 
-    std::cout << "complete, (" << cubeCount << "," << planeCount << "," <<
-        lineCount << "," << pointCount << ") ";
-
-    fout.close();
-}
-
-
-
-Point3D getPointOf(Matrix3D& matrix, short boxSize)
-{
-    for (std::size_t d = 0; d < HEIGHT; d++)
-        for (std::size_t x = 0; x < SIZE; x++)
-            for (std::size_t y = 0; y < SIZE; y++)
-                if (matrix[d][x][y] == boxSize)
-                    return Point3D((int)d, (int)x, (int)y);
-
-    return Point3D(-1, -1, -1);
-}
-
-
+    if (hasFlag(argc, argv, "--sdf"))
+    {
+        std::size_t band = std::min((std::size_t)getOption(argc, argv, "--sdf-band", SDF_BAND), MAX_SDF_BAND);
+        std::cout << "Transforming distances within " << band << " voxels... ";
+        std::cout.flush();
+        log.begin("sdf", voxels);
+        DistanceField field(volume, band);
+        field.write("geometry.sdf");
+        log.note("band", band);
+        log.note("stored_bricks", field.getStoredBricks());
+        log.end();
+        std::cout << field.getStoredBricks() << " bricks near the surface." << std::endl;
+    }
 
-//the given point must be the upper left corner (minimum) of the box
-Bounds2D eliminateBoxOf(Matrix3D& matrix, Point3D point)
-{
-    std::size_t sD = (std::size_t)point.d_, sX = (std::size_t)point.x_, sY = (std::size_t)point.y_;
-    short boxSize = matrix[sD][sX][sY];
-    matrix[sD][sX][sY] = -1;
-
-    //look d+ and x+ and y+ direction due to algorithm in getPointOf
-
-    std::size_t dLength = 0; //number of boxes in the x direction
-    while (sD + (dLength + 1) * boxSize < HEIGHT && matrix[sD + (dLength + 1) * boxSize][sX][sY] == boxSize)
-        dLength++;
-    if (sD + (dLength + 1) * boxSize == HEIGHT && matrix[sD + (dLength + 1) * boxSize - 1][sX][sY] == boxSize)
-        dLength++;
-
-    std::size_t xLength = 0; //number of boxes in the x direction
-    while (sX + (xLength + 1) * boxSize < SIZE && matrix[sD][sX + (xLength + 1) * boxSize][sY] == boxSize)
-        xLength++;
-    if (sX + (xLength + 1) * boxSize == SIZE && matrix[sD][sX + (xLength + 1) * boxSize - 1][sY] == boxSize)
-        dLength++;
-
-    std::size_t yLength = 0; //number of boxes in the x direction
-    while (sY + (yLength + 1) * boxSize < SIZE && matrix[sD][sX][sY + (yLength + 1) * boxSize] == boxSize)
-        yLength++;
-    if (sY + (yLength + 1) * boxSize == SIZE && matrix[sD][sX][sY + (yLength + 1) * boxSize - 1] == boxSize)
-        dLength++;
-
-    //keep track of largest element
-    std::size_t maxLength = 0;
-    std::size_t* maxDimension = &dLength;
-    if (dLength > maxLength)
+    if (hasFlag(argc, argv, "--mesh"))
     {
-        maxLength = dLength;
-        maxDimension = &dLength;
+        std::cout << "Extracting surface... ";
+        std::cout.flush();
+        log.begin("mesh", voxels, 3);
+        SurfaceMesh mesh(volume);
+        mesh.write("geometry.mesh");
+        log.note("vertices", mesh.getVertexCount());
+        log.note("triangles", mesh.getTriangleCount());
+        log.end();
+        std::cout << mesh.getVertexCount() << " vertices, " <<
+            mesh.getTriangleCount() << " triangles." << std::endl;
+        reportMisses();
+
+        std::cout << "Program complete." << std::endl;
+        return EXIT_SUCCESS;
     }
 
-    if (xLength > maxLength)
+    std::vector<Bounds2D> boxes;
+    log.begin("cuboids", voxels, incremental || hasFlag(argc, argv, "--greedy") ? 2 : 1);
+    if (incremental)
     {
-        maxLength = xLength;
-        maxDimension = &xLength;
+        std::cout << "Growing cuboids... ";
+        std::cout.flush();
+        boxes = cache->findCuboids(volume);
+        std::cout << "regrew " << cache->getRegrownSlabs() << " slabs." << std::endl;
+        log.note("regrown_slabs", cache->getRegrownSlabs());
+        if (!cache->write(CACHE_FILE))
+            std::cout << "Unable to write \"" << CACHE_FILE << "\"!" << std::endl;
     }
+    else if (hasFlag(argc, argv, "--greedy"))
+    {
+        std::cout << "Growing cuboids... ";
+        std::cout.flush();
+        boxes = findCuboids(volume, MIN_BOX_SIZE);
+        std::cout << "done." << std::endl;
+    }
+    else
+    {
+        std::cout << "Building octree... ";
+        std::cout.flush();
+        Octree octree(volume, MIN_BOX_SIZE);
+        std::cout << octree.getNodeCount() << " nodes." << std::endl;
+        log.note("nodes", octree.getNodeCount());
+        boxes = mergeRuns(octree.getFullNodes());
+    }
+    log.end();
+    reportMisses();
 
-    if (yLength > maxLength)
+    std::cout << "Calculating geometry, ";
+    log.begin("write", 0);
+    logBoxes(listBoxes(boxes));
+    writeGeometry(listBoxes(boxes), std::string("geometry.dat"));
+    writeBinaryGeometry(boxes, volume.getHeight(), volume.getSize(), std::string("geometry.bin"));
+    log.end();
+    std::cout << "finished." << std::endl;
+
+    std::cout << "Writing levels of detail... ";
+    std::cout.flush();
+    std::size_t levels = (std::size_t)getOption(argc, argv, "--lod-levels", LOD_LEVELS);
+    log.begin("levels", voxels, 3 * std::max(levels, (std::size_t)2) - 3); //a downsample and a greedy search per level
+    std::vector<std::size_t> levelBoxes = writeLevels(volume, levels, MIN_BOX_SIZE);
+    for (std::size_t level = 0; level < levelBoxes.size(); level++)
     {
-        maxLength = yLength;
-        maxDimension = &yLength;
+        log.note("level" + std::to_string(level + 1) + "_boxes", levelBoxes[level]);
+        std::cout << levelBoxes[level] << " boxes" << (level + 1 < levelBoxes.size() ? ", " : ".");
     }
+    if (levelBoxes.empty())
+        std::cout << "none.";
+    log.end();
+    std::cout << std::endl;
 
-    //if not a point, zero out all others
-    if (&dLength != maxDimension)
-        dLength = 0;
-    if (&xLength != maxDimension)
-        xLength = 0;
-    if (&yLength != maxDimension)
-        yLength = 0;
-
-    //max specifies the maximum bounds in only one dimension
-    Point3D max = Point3D((int)(sD + std::max((int)dLength, 1) * boxSize),
-                          (int)(sX + std::max((int)xLength, 1) * boxSize),
-                          (int)(sY + std::max((int)yLength, 1) * boxSize));
-
-    //eliminate area inside bounds
-    for (int d = point.d_; d < max.d_; d++)
-        for (int x = point.x_; x < max.x_; x++)
-            for (int y = point.y_; y < max.y_; y++)
-                matrix[(std::size_t)d][(std::size_t)x][(std::size_t)y] = 0;
-
-    return std::make_pair(point, max);
+    std::cout << "Program complete." << std::endl;
+
+    return EXIT_SUCCESS;
 }
@@ -15,18 +15,45 @@ struct Point3D
     int d_, x_, y_;
 };
 
+#include "Volume.hpp"
+#include "Component.struct"
+#include "GeometryFile.hpp"
+#include <functional>
 #include <vector>
 #include <string>
 
-typedef std::vector<std::vector<short>> Matrix2D;
-typedef std::vector<Matrix2D> Matrix3D;
 typedef std::pair<Point3D, Point3D> Bounds2D;
-
-Matrix3D readMatrix(std::vector<std::string>& filenames);
-void removeIslands(Matrix3D& matrix, std::size_t startD, std::size_t startX, std::size_t startY);
-bool compress(Matrix3D& matrix, std::size_t level);
-void writeGeometry(Matrix3D& matrix, std::string filename);
-Point3D getPointOf(Matrix3D& matrix, short boxSize);
-Bounds2D eliminateBoxOf(Matrix3D& matrix, Point3D point);
+typedef std::function<void(const Bounds2D&)> BoxVisitor;
+typedef std::function<void(const BoxVisitor&)> BoxSource; //visits the same boxes in the same order on every call
+
+class IntervalVolume;
+
+bool hasFlag(int argc, char** argv, const std::string& flag);
+unsigned int getOption(int argc, char** argv, const std::string& flag, unsigned int defaultValue);
+std::vector<std::string> readManifest(const std::string& filename);
+Volume readMatrix(const std::vector<std::string>& filenames, std::size_t size);
+void readSlices(const std::vector<std::string>& filenames, const std::vector<std::size_t>& layers, Volume& volume);
+std::vector<std::uint64_t> hashSlices(const std::vector<std::string>& filenames);
+IntervalVolume readIntervals(const std::vector<std::string>& filenames, std::size_t size);
+std::vector<bool> selectComponents(const std::vector<Component>& components, std::size_t minSize);
+void writeComponents(const std::vector<Component>& components, std::string filename);
+std::size_t removeIslands(Volume& volume, std::size_t startD, std::size_t startX, std::size_t startY);
+void fillRow(const Volume& volume, Volume& reached, std::size_t d, std::size_t x);
+bool spreadRow(const Volume& volume, Volume& reached,
+    std::size_t fromD, std::size_t fromX, std::size_t toD, std::size_t toX);
+std::size_t fillCavities(Volume& volume);
+std::vector<Bounds2D> mergeRuns(const std::vector<Bounds2D>& nodes);
+Volume downsample(const Volume& volume);
+std::vector<std::size_t> writeLevels(const Volume& cleaned, std::size_t levels, std::size_t minBoxSize);
+BoxSource listBoxes(const std::vector<Bounds2D>& boxes);
+std::vector<std::size_t> countBoxShapes(const BoxSource& boxes, std::size_t blockSize);
+std::string checkCoverage(const Volume& cleaned, const std::vector<Bounds2D>& boxes, std::size_t blockSize);
+bool findSeed(const Volume& volume, std::size_t& seedD, std::size_t& seedX, std::size_t& seedY);
+bool isSameVolume(const Volume& a, const Volume& b);
+void writeGeometry(const BoxSource& boxes, std::string filename);
+void writeBinaryGeometry(const std::vector<Bounds2D>& boxes, std::size_t height,
+    std::size_t size, std::string filename);
+void writeBinaryGeometry(const BoxSource& boxes, std::size_t height,
+    std::size_t size, std::string filename, std::size_t bufferBoxes);
 
 #endif
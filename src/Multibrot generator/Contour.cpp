@@ -0,0 +1,207 @@
+
+#include "Contour.hpp"
+#include <fstream>
+#include <cstdint>
+
+
+const unsigned int BISECTION_STEPS = 6; //each halves the uncertainty along an edge
+
+//edges of a marching squares cell, listed as pairs per corner case
+enum CellEdge { BOTTOM, RIGHT, TOP, LEFT, NONE };
+const CellEdge SEGMENTS[16][4] = {
+    { NONE, NONE, NONE, NONE },      { LEFT, BOTTOM, NONE, NONE },
+    { BOTTOM, RIGHT, NONE, NONE },   { LEFT, RIGHT, NONE, NONE },
+    { RIGHT, TOP, NONE, NONE },      { LEFT, BOTTOM, RIGHT, TOP }, //saddle, 5
+    { BOTTOM, TOP, NONE, NONE },     { LEFT, TOP, NONE, NONE },
+    { TOP, LEFT, NONE, NONE },       { BOTTOM, TOP, NONE, NONE },
+    { BOTTOM, RIGHT, TOP, LEFT },    { RIGHT, TOP, NONE, NONE }, //saddle, 10
+    { LEFT, RIGHT, NONE, NONE },     { BOTTOM, RIGHT, NONE, NONE },
+    { LEFT, BOTTOM, NONE, NONE },    { NONE, NONE, NONE, NONE }
+};
+
+
+namespace
+{
+    /*
+        Pixels live on a grid padded by one outside pixel on every side, so
+        every contour closes. Edge (x, y, 0) joins pixel (x, y) to (x + 1, y)
+        and edge (x, y, 1) joins it to (x, y + 1).
+    */
+    class EdgeGrid
+    {
+        public:
+            EdgeGrid(const Matrix2D& matrix) :
+                matrix_(matrix), size_((int)matrix.size()),
+                links_(2 * (std::size_t)(size_ + 2) * (std::size_t)(size_ + 2), std::make_pair(-1, -1))
+            {}
+
+            bool isInside(int x, int y) const
+            {
+                if (x < 0 || y < 0 || x >= size_ || y >= size_)
+                    return false;
+                return matrix_[(std::size_t)x][(std::size_t)y];
+            }
+
+            int getEdge(int x, int y, int direction) const
+            {
+                return ((x + 1) * (size_ + 2) + (y + 1)) * 2 + direction;
+            }
+
+            int getCellEdge(int x, int y, CellEdge edge) const
+            {
+                switch (edge)
+                {
+                    case BOTTOM: return getEdge(x, y, 0);
+                    case RIGHT:  return getEdge(x + 1, y, 1);
+                    case TOP:    return getEdge(x, y + 1, 0);
+                    default:     return getEdge(x, y, 1);
+                }
+            }
+
+            void link(int a, int b)
+            {
+                attach(a, b);
+                attach(b, a);
+            }
+
+            std::pair<int, int>& getLinks(int edge)
+            {
+                return links_[(std::size_t)edge];
+            }
+
+            std::size_t getEdgeCount() const
+            {
+                return links_.size();
+            }
+
+            //locates the boundary along the edge by bisecting in fractal space
+            Point2D refine(int edge, float d) const
+            {
+                int cell = edge / 2;
+                int x = cell / (size_ + 2) - 1, y = cell % (size_ + 2) - 1;
+                int nx = x + (edge % 2 == 0 ? 1 : 0), ny = y + (edge % 2 == 1 ? 1 : 0);
+                if (!isInside(x, y))
+                {
+                    std::swap(x, nx);
+                    std::swap(y, ny);
+                }
+
+                Point2D inside = toFractal(x, y), outside = toFractal(nx, ny);
+                for (unsigned int j = 0; j < BISECTION_STEPS; j++)
+                {
+                    Point2D middle((inside.first + outside.first) / 2,
+                                   (inside.second + outside.second) / 2);
+                    if (isInsideFractal(middle.first, middle.second, d))
+                        inside = middle;
+                    else
+                        outside = middle;
+                }
+
+                return Point2D((inside.first + outside.first) / 2,
+                               (inside.second + outside.second) / 2);
+            }
+
+        private:
+            void attach(int edge, int neighbor)
+            {
+                auto& links = links_[(std::size_t)edge];
+                if (links.first < 0)
+                    links.first = neighbor;
+                else
+                    links.second = neighbor;
+            }
+
+            Point2D toFractal(int x, int y) const
+            {
+                return Point2D(4.0f * (float)x / (float)size_ - 2,
+                               4.0f * (float)y / (float)size_ - 2);
+            }
+
+            const Matrix2D& matrix_;
+            int size_;
+            std::vector<std::pair<int, int>> links_;
+    };
+}
+
+
+
+/*
+    Marching squares over the pixel grid. Diagonal inside pixels are kept
+    apart at saddles, matching the face connectivity the converter uses.
+    Each crossing edge joins exactly two cell segments, so chaining them
+    yields closed loops. Every loop vertex is refined by bisection.
+*/
+std::vector<Polyline> extractContours(const Matrix2D& matrix, float d)
+{
+    EdgeGrid grid(matrix);
+    int size = (int)matrix.size();
+
+    for (int x = -1; x < size; x++)
+    {
+        for (int y = -1; y < size; y++)
+        {
+            int index = (grid.isInside(x, y) ? 1 : 0) | (grid.isInside(x + 1, y) ? 2 : 0) |
+                (grid.isInside(x + 1, y + 1) ? 4 : 0) | (grid.isInside(x, y + 1) ? 8 : 0);
+
+            const CellEdge* segments = SEGMENTS[index];
+            for (int j = 0; j < 4 && segments[j] != NONE; j += 2)
+                grid.link(grid.getCellEdge(x, y, segments[j]), grid.getCellEdge(x, y, segments[j + 1]));
+        }
+    }
+
+    std::vector<Polyline> contours;
+    std::vector<bool> visited(grid.getEdgeCount(), false);
+    for (int start = 0; start < (int)grid.getEdgeCount(); start++)
+    {
+        if (visited[(std::size_t)start] || grid.getLinks(start).first < 0)
+            continue;
+
+        Polyline contour;
+        int previous = -1, current = start;
+        do
+        {
+            visited[(std::size_t)current] = true;
+            contour.push_back(grid.refine(current, d));
+
+            auto links = grid.getLinks(current);
+            int next = links.first != previous ? links.first : links.second;
+            previous = current;
+            current = next;
+        } while (current != start);
+
+        contours.push_back(contour);
+    }
+
+    return contours;
+}
+
+
+
+/*
+    Binary layout, native endianness:
+        char[4] "MBC1", float d, uint32 contour count,
+        then per contour: uint32 point count, followed by (float x, float y)s
+*/
+void writeContours(const std::vector<Polyline>& contours, float d, std::string filename)
+{
+    std::ofstream fout;
+    fout.open(filename, std::ofstream::out | std::ofstream::binary);
+
+    auto count = (uint32_t)contours.size();
+    fout.write("MBC1", 4);
+    fout.write(reinterpret_cast<const char*>(&d), sizeof(d));
+    fout.write(reinterpret_cast<const char*>(&count), sizeof(count));
+
+    for (const auto& contour : contours)
+    {
+        auto points = (uint32_t)contour.size();
+        fout.write(reinterpret_cast<const char*>(&points), sizeof(points));
+        for (const auto& point : contour)
+        {
+            fout.write(reinterpret_cast<const char*>(&point.first), sizeof(float));
+            fout.write(reinterpret_cast<const char*>(&point.second), sizeof(float));
+        }
+    }
+
+    fout.close();
+}
@@ -0,0 +1,14 @@
+
+#ifndef CONTOUR
+#define CONTOUR
+
+#include "main.hpp"
+#include <utility>
+
+typedef std::pair<float, float> Point2D; //in fractal space
+typedef std::vector<Point2D> Polyline; //closed, the last point joins the first
+
+std::vector<Polyline> extractContours(const Matrix2D& matrix, float d);
+void writeContours(const std::vector<Polyline>& contours, float d, std::string filename);
+
+#endif
@@ -0,0 +1,582 @@
+#include "Slices.hpp"
+#include <queue>
+#include <complex>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <limits>
+
+
+const unsigned int CHUNK_SIZE = 32; //seems to be the fastest factor
+const unsigned int MAX_DEPTH = 1024; //max iterations to follow the point
+const float MIN_EXPONENT = 1, EXPONENT_RANGE = 32; //d spans (1, 33]
+const unsigned int PROBE_SIZE = 64; //resolution of the adaptive sampling probes
+const unsigned int PROBE_SLICES = 256; //exponent intervals the probes measure
+const float UNIFORM_SHARE = 0.1f; //fraction of the budget spread evenly
+const double ESCAPE_RADIUS = 1e4; //distance estimates settle once |z| is this large
+const unsigned int EXTRA_ITERATIONS = 8; //cap on iterations spent reaching it
+const float SKIP_FACTOR = 0.25f; //fraction of the estimate proven empty, with margin
+const unsigned int PREVIEW_SIZE = 64; //resolution of the first progressive level
+const unsigned int COST_PROBE_SIZE = 32; //resolution of the per-slice cost probes
+
+
+float toExponent(float fraction)
+{
+    return fraction * EXPONENT_RANGE + MIN_EXPONENT;
+}
+
+
+
+//every distinct exponent gets its own name, however close the adaptive slices are packed
+std::string getFilename(float d, const std::string& extension)
+{
+    std::stringstream filename;
+    filename.precision(std::numeric_limits<float>::max_digits10);
+    filename << "multibrot,d=" << d << "." << extension;
+    return filename.str();
+}
+
+
+
+std::vector<Slice> planUniformSlices()
+{
+    std::vector<Slice> slices;
+    for (unsigned int height = 1; height <= MAX_HEIGHT; height++)
+        slices.push_back(Slice(height, toExponent(height / (float)MAX_HEIGHT)));
+    return slices;
+}
+
+
+
+/*
+    Probe the shape at low resolution over a fine grid of exponents, then
+    distribute the slice budget in proportion to how many pixels flip between
+    neighbouring probes. A uniform share keeps the quiet stretches sampled.
+    Slices that would land on the same float exponent are kept once, so a
+    busy stretch can leave the stack a little short of the budget.
+*/
+std::vector<Slice> planAdaptiveSlices(unsigned int budget)
+{
+    std::cout << "Probing " << PROBE_SLICES << " exponents at " << PROBE_SIZE <<
+        "x" << PROBE_SIZE << "... ";
+    std::cout.flush();
+
+    std::vector<bool> previous = renderProbe(toExponent(0), PROBE_SIZE);
+    std::vector<float> weights;
+    float total = 0;
+    for (unsigned int j = 1; j <= PROBE_SLICES; j++)
+    {
+        std::vector<bool> current = renderProbe(toExponent(j / (float)PROBE_SLICES), PROBE_SIZE);
+
+        unsigned int changed = 0;
+        for (std::size_t index = 0; index < current.size(); index++)
+            if (current[index] != previous[index])
+                changed++;
+
+        weights.push_back(changed);
+        total += changed;
+        previous.swap(current);
+    }
+
+    float uniformWeight = total > 0 ? UNIFORM_SHARE * total / PROBE_SLICES : 1;
+    for (auto& weight : weights)
+        weight += uniformWeight;
+    total += uniformWeight * PROBE_SLICES;
+
+    //place each slice at an evenly spaced quantile of the cumulative change, once per exponent
+    std::vector<Slice> slices;
+    std::size_t interval = 0;
+    float cumulative = 0;
+    for (unsigned int j = 1; j <= budget; j++)
+    {
+        float target = total * j / budget;
+        while (interval + 1 < weights.size() && cumulative + weights[interval] < target)
+            cumulative += weights[interval++];
+
+        float t = std::min(1.0f, (target - cumulative) / weights[interval]);
+        float d = toExponent((interval + t) / PROBE_SLICES);
+        if (slices.empty() || d > slices.back().d_)
+            slices.push_back(Slice((unsigned int)slices.size() + 1, d));
+    }
+
+    std::cout << "done, " << slices.size() << " distinct exponents." << std::endl;
+    return slices;
+}
+
+
+
+std::vector<bool> renderProbe(float d, unsigned int size)
+{
+    std::vector<bool> probe(size * size, false);
+    for (unsigned int x = 0; x < size; x++)
+        for (unsigned int y = 0; y < size; y++)
+            probe[x * size + y] = isInsideFractal(
+                toFractalSpace(x * IMAGE_SIZE / size),
+                toFractalSpace(y * IMAGE_SIZE / size), d);
+    return probe;
+}
+
+
+
+/*
+    Estimates each slice's cost as the iterations spent on a coarse probe,
+    scaled up to the full image. The scale is irrelevant for ordering; the
+    per-slice log calibrates it to seconds as rendering progresses.
+*/
+void predictCosts(std::vector<Slice>& slices)
+{
+    std::cout << "Probing the cost of " << slices.size() << " slices at " <<
+        COST_PROBE_SIZE << "x" << COST_PROBE_SIZE << "... ";
+    std::cout.flush();
+
+    const unsigned int STEP = IMAGE_SIZE / COST_PROBE_SIZE;
+    for (auto& slice : slices)
+    {
+        double iterations = 0;
+        for (unsigned int x = 0; x < COST_PROBE_SIZE; x++)
+            for (unsigned int y = 0; y < COST_PROBE_SIZE; y++)
+                iterations += countIterations(toFractalSpace(x * STEP), toFractalSpace(y * STEP), slice.d_);
+        slice.cost_ = iterations * STEP * STEP;
+    }
+
+    std::cout << "done." << std::endl;
+}
+
+
+
+/*
+    Longest processing time first: slices are taken in order of decreasing
+    cost and each goes to the shard with the least predicted work so far.
+    Returns this shard's slices, most expensive first, so that the cheap
+    ones fill in the tail.
+*/
+std::vector<Slice> scheduleSlices(const std::vector<Slice>& slices, unsigned int shard, unsigned int shards)
+{
+    std::vector<Slice> ordered(slices);
+    std::stable_sort(ordered.begin(), ordered.end(),
+        [](const Slice& a, const Slice& b) { return a.cost_ > b.cost_; });
+
+    std::vector<double> loads(shards, 0);
+    std::vector<Slice> assigned;
+    for (const auto& slice : ordered)
+    {
+        auto lightest = std::min_element(loads.begin(), loads.end()) - loads.begin();
+        loads[(std::size_t)lightest] += slice.cost_;
+        if ((unsigned int)lightest + 1 == shard)
+            assigned.push_back(slice);
+    }
+
+    std::cout << "Shard " << shard << " / " << shards << " takes " << assigned.size() <<
+        " slices, " << (loads[shard - 1] / std::accumulate(loads.begin(), loads.end(), 0.0) * 100) <<
+        "% of the predicted work." << std::endl;
+
+    return assigned;
+}
+
+
+
+//records which exponent and file belong to each height, in height order
+void writeManifest(const std::vector<Slice>& slices, std::string filename)
+{
+    std::ofstream fout;
+    fout.open(filename, std::ofstream::out);
+
+    fout.precision(std::numeric_limits<float>::max_digits10);
+    for (const auto& slice : slices)
+        fout << slice.height_ << " " << slice.d_ << " " << getFilename(slice.d_) << "\n";
+
+    fout.close();
+}
+
+
+
+/*
+    Renders the whole stack at PREVIEW_SIZE, then again at each doubled
+    resolution below IMAGE_SIZE. Every level overwrites the slice files as it
+    completes, upsampled to full size, so a usable preview exists early on.
+    The levels take some pixels from their neighbours, so the full resolution
+    is left to the usual slice loop, which renders every slice exactly.
+*/
+void renderProgressively(const std::vector<Slice>& slices)
+{
+    std::vector<Matrix2D> levels(slices.size());
+    for (unsigned int resolution = PREVIEW_SIZE; resolution < IMAGE_SIZE; resolution *= 2)
+    {
+        for (std::size_t j = 0; j < slices.size(); j++)
+        {
+            std::cout << "Processing " << slices[j].height_ << " / " << slices.size() <<
+                " (" << slices[j].d_ << ") at " << resolution << "x" << resolution << " ... ";
+            std::cout.flush();
+
+            levels[j] = renderLevel(levels[j], resolution, slices[j].d_);
+            Matrix2D matrix = upsample(levels[j]);
+            writeMatrix(matrix, getFilename(slices[j].d_));
+
+            std::cout << "done" << std::endl;
+        }
+    }
+}
+
+
+
+/*
+    Samples the slice on a resolution x resolution subset of the pixel grid.
+    Samples shared with the coarser level are copied, and a new sample whose
+    surrounding 4x4 coarse samples all agree takes their value uncomputed.
+*/
+Matrix2D renderLevel(const Matrix2D& coarse, unsigned int resolution, float d)
+{
+    unsigned int step = IMAGE_SIZE / resolution;
+    Matrix2D level(resolution, std::vector<bool>(resolution, false));
+
+    for (unsigned int x = 0; x < resolution; x++)
+    {
+        for (unsigned int y = 0; y < resolution; y++)
+        {
+            if (!coarse.empty())
+            {
+                if (x % 2 == 0 && y % 2 == 0)
+                {
+                    level[x][y] = coarse[x / 2][y / 2];
+                    continue;
+                }
+
+                if (isUniformAround(coarse, x / 2, y / 2))
+                {
+                    level[x][y] = coarse[x / 2][y / 2];
+                    continue;
+                }
+            }
+
+            level[x][y] = isInsideFractal(toFractalSpace(x * step), toFractalSpace(y * step), d);
+        }
+    }
+
+    return level;
+}
+
+
+
+//true if the coarse samples from (x - 1, y - 1) to (x + 2, y + 2) all agree
+bool isUniformAround(const Matrix2D& coarse, unsigned int x, unsigned int y)
+{
+    unsigned int size = (unsigned int)coarse.size();
+    unsigned int minX = x > 0 ? x - 1 : 0, maxX = std::min(x + 2, size - 1);
+    unsigned int minY = y > 0 ? y - 1 : 0, maxY = std::min(y + 2, size - 1);
+
+    bool state = coarse[x][y];
+    for (unsigned int cx = minX; cx <= maxX; cx++)
+        for (unsigned int cy = minY; cy <= maxY; cy++)
+            if (coarse[cx][cy] != state)
+                return false;
+
+    return true;
+}
+
+
+
+//scales a level up to IMAGE_SIZE, each sample covering a square of pixels
+Matrix2D upsample(const Matrix2D& level)
+{
+    unsigned int step = IMAGE_SIZE / (unsigned int)level.size();
+    Matrix2D matrix;
+    initializeMatrix(matrix);
+
+    for (unsigned int x = 0; x < IMAGE_SIZE; x++)
+        for (unsigned int y = 0; y < IMAGE_SIZE; y++)
+            matrix[x][y] = level[x / step][y / step];
+
+    return matrix;
+}
+
+
+
+//renders every chunk of the slice, along with distances if they are wanted
+Matrix2D renderSlice(float d, DistanceMatrix& distances, bool skipExterior)
+{
+    std::queue<Chunk> chunks;
+    for (unsigned int x = 0; x < IMAGE_SIZE; x += CHUNK_SIZE)
+        for (unsigned int y = 0; y < IMAGE_SIZE; y += CHUNK_SIZE)
+            chunks.push(Chunk(x, y, x + CHUNK_SIZE, y + CHUNK_SIZE));
+
+    Matrix2D matrix;
+    initializeMatrix(matrix);
+
+    while (!chunks.empty())
+    {
+        //std::cout << chunks.size() << std::endl;
+        if (distances.empty())
+            render(chunks.front(), matrix, d);
+        else
+            renderWithDistance(chunks.front(), matrix, distances, d, skipExterior);
+        chunks.pop();
+    }
+
+    return matrix;
+}
+
+
+
+void initializeMatrix(Matrix2D& matrix)
+{
+    for (std::size_t j = 0; j < IMAGE_SIZE; j++)
+        matrix.push_back(std::vector<bool>(IMAGE_SIZE, 0));
+}
+
+
+
+/*
+    For each chunk, check boundaries.
+        If all black, then chunk is black
+        else complete rest of the chunk manually
+*/
+void render(Chunk chunk, Matrix2D& matrix, float d)
+{
+    if (bordersAreInside(chunk, d))
+    {
+        for (unsigned int x = 0; x < CHUNK_SIZE; x++)
+            for (unsigned int y = 0; y < CHUNK_SIZE; y++)
+                matrix[chunk.minX_ + x][chunk.minY_ + y] = true;
+        return;
+    }
+
+    for (unsigned int x = 0; x < CHUNK_SIZE; x++)
+    {
+        for (unsigned int y = 0; y < CHUNK_SIZE; y++)
+        {
+            float fx = toFractalSpace(chunk.minX_ + x);
+            float fy = toFractalSpace(chunk.minY_ + y);
+            matrix[chunk.minX_ + x][chunk.minY_ + y] = isInsideFractal(fx, fy, d);
+        }
+    }
+}
+
+
+
+/*
+    Like render(), but every escaping pixel also yields a lower bound on its
+    distance to the set. With skipping enabled, all pixels inside that disc are
+    known to be outside and are never iterated; they inherit the bound reduced
+    by their offset from the centre. Inside pixels have a distance of 0, and
+    escaping pixels whose bound overflowed have NO_DISTANCE.
+*/
+void renderWithDistance(Chunk chunk, Matrix2D& matrix, DistanceMatrix& distances, float d, bool skip)
+{
+    if (bordersAreInside(chunk, d))
+    {
+        for (unsigned int x = 0; x < CHUNK_SIZE; x++)
+        {
+            for (unsigned int y = 0; y < CHUNK_SIZE; y++)
+            {
+                matrix[chunk.minX_ + x][chunk.minY_ + y] = true;
+                distances[chunk.minX_ + x][chunk.minY_ + y] = 0;
+            }
+        }
+        return;
+    }
+
+    for (unsigned int x = chunk.minX_; x < chunk.maxX_; x++)
+    {
+        for (unsigned int y = chunk.minY_; y < chunk.maxY_; y++)
+        {
+            if (distances[x][y] >= 0) //already proven to be outside
+                continue;
+
+            bool inside;
+            float distance = escapeDistance(toFractalSpace(x), toFractalSpace(y), d, inside);
+            matrix[x][y] = inside;
+            distances[x][y] = distance;
+
+            if (skip && distance > 0)
+                markExterior(chunk, distances, x, y, distance * SKIP_FACTOR);
+        }
+    }
+}
+
+
+
+/*
+    Records every unknown pixel of the chunk within the given fractal-space
+    radius as outside. Marking stops at the chunk so that overlapping discs
+    cost at most one chunk each; neighbouring chunks find their own.
+*/
+void markExterior(Chunk chunk, DistanceMatrix& distances, unsigned int centerX, unsigned int centerY, float radius)
+{
+    const float PIXEL_SIZE = 4.0f / IMAGE_SIZE;
+    float reach = radius / PIXEL_SIZE;
+    if (reach < 1)
+        return;
+
+    int minX = std::max((int)(centerX - reach), (int)chunk.minX_);
+    int maxX = std::min((int)(centerX + reach), (int)chunk.maxX_ - 1);
+    for (int x = minX; x <= maxX; x++)
+    {
+        float dx = (float)(x - (int)centerX);
+        int span = (int)std::sqrt(reach * reach - dx * dx);
+        int minY = std::max((int)centerY - span, (int)chunk.minY_);
+        int maxY = std::min((int)centerY + span, (int)chunk.maxY_ - 1);
+
+        for (int y = minY; y <= maxY; y++)
+        {
+            auto& distance = distances[(std::size_t)x][(std::size_t)y];
+            if (distance < 0)
+            {
+                float dy = (float)(y - (int)centerY);
+                distance = radius - std::sqrt(dx * dx + dy * dy) * PIXEL_SIZE;
+            }
+        }
+    }
+}
+
+
+
+bool bordersAreInside(Chunk chunk, float d)
+{
+    bool black = true;
+
+    for (unsigned int j = 0; black && j < CHUNK_SIZE; j++)
+        if (!isInsideFractal(toFractalSpace(chunk.minX_), toFractalSpace(chunk.minY_ + j), d))
+            black = false;
+
+    for (unsigned int j = 0; black && j < CHUNK_SIZE; j++)
+        if (!isInsideFractal(toFractalSpace(chunk.maxX_), toFractalSpace(chunk.minY_ + j), d))
+            black = false;
+
+    for (unsigned int j = 0; black && j < CHUNK_SIZE; j++)
+        if (!isInsideFractal(toFractalSpace(chunk.minX_ + j), toFractalSpace(chunk.minY_), d))
+            black = false;
+
+    for (unsigned int j = 0; black && j < CHUNK_SIZE; j++)
+        if (!isInsideFractal(toFractalSpace(chunk.minX_ + j), toFractalSpace(chunk.maxY_), d))
+            black = false;
+
+    return black;
+}
+
+
+
+float toFractalSpace(unsigned int pixel)
+{
+    return 4.0f * pixel / IMAGE_SIZE - 2;
+}
+
+
+
+bool isInsideFractal(float x, float y, float d)
+{
+    return countIterations(x, y, d) == MAX_DEPTH;
+}
+
+
+
+//number of iterations before the point escapes, or MAX_DEPTH if it never does
+unsigned int countIterations(float x, float y, float d)
+{
+    std::complex<float> c(x, y);
+    std::complex<float> z(0, 0);
+
+    unsigned int i;
+    for (i = 0; norm(z) < 4 && i < MAX_DEPTH; i++)
+        z = pow(z, d) + c;
+
+    return i;
+}
+
+
+
+/*
+    Returns 0 for points inside the set. The orbit is iterated once, on the
+    same float steps as countIterations, so the inside test stays exactly
+    that of isInsideFractal; each z^d is kept along the way. Only once the
+    point escapes is dz/dc run up from them, without repeating the powers,
+    and the orbit is followed for at most EXTRA_ITERATIONS more steps in
+    double precision, until |z| log|z| / 2|dz/dc|, a lower bound on the
+    distance from the point to the set, becomes accurate. Returns
+    NO_DISTANCE if dz/dc overflowed.
+*/
+float escapeDistance(float x, float y, float d, bool& inside)
+{
+    std::complex<float> c(x, y);
+    std::complex<float> z(0, 0);
+    std::complex<float> powers[MAX_DEPTH];
+
+    unsigned int i;
+    for (i = 0; norm(z) < 4 && i < MAX_DEPTH; i++)
+    {
+        powers[i] = pow(z, d);
+        z = powers[i] + c;
+    }
+
+    inside = i == MAX_DEPTH;
+    if (inside)
+        return 0;
+
+    //dz/dc = d z^(d - 1) dz/dc + 1, where z^(d - 1) is the kept power over z
+    std::complex<float> previous(0, 0);
+    std::complex<double> dz(0, 0);
+    for (unsigned int j = 0; j < i; j++)
+    {
+        dz = norm(previous) > 0 ? (double)d * std::complex<double>(powers[j] / previous) * dz + 1.0 : 1.0;
+        previous = powers[j] + c;
+    }
+
+    std::complex<double> far(z);
+    for (unsigned int j = 0; std::abs(far) < ESCAPE_RADIUS && j < EXTRA_ITERATIONS; j++)
+    {
+        std::complex<double> next = pow(far, (double)d);
+        dz = (double)d * (next / far) * dz + 1.0;
+        far = next + std::complex<double>(c);
+    }
+
+    double magnitude = std::abs(far);
+    double distance = 0.5 * magnitude * std::log(magnitude) / std::abs(dz);
+    return std::isfinite(distance) && distance > 0 ? (float)distance : NO_DISTANCE;
+}
+
+
+
+//distances are written as raw native floats, row by row
+void writeDistances(DistanceMatrix& distances, std::string filename)
+{
+    std::ofstream fout;
+    fout.open(filename, std::ofstream::out | std::ofstream::binary);
+
+    for (const auto &row : distances)
+        fout.write(reinterpret_cast<const char*>(row.data()), (std::streamsize)(row.size() * sizeof(float)));
+
+    fout.close();
+}
+
+
+
+void writeMatrix(Matrix2D& matrix, std::string filename)
+{
+    std::ofstream fout;
+    fout.open(filename, std::ofstream::out);
+
+    for (const auto &row : matrix)
+    {
+        bool state = false;
+        int count = 0;
+
+        for (int index = 0; index < row.size(); index++)
+        {
+            if (row[index] == state)
+                count++;
+            else
+            {
+                fout << count << " ";
+                count = 1;
+                state = !state;
+            }
+        }
+
+        fout << count << " ";
+        fout << std::endl;
+    }
+
+    fout.close();
+}
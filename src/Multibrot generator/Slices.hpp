@@ -0,0 +1,53 @@
+#ifndef SLICES
+#define SLICES
+
+/**
+    Everything that plans, renders and writes the slices of the Multibrot
+    stack, apart from the command line. The generator drives these one
+    slice at a time, and the pipeline links them directly to feed its
+    converter stages without going through the slice files.
+**/
+
+#include "Chunk.struct"
+#include "Slice.struct"
+#include <vector>
+#include <string>
+
+typedef std::vector<std::vector<bool>> Matrix2D;
+typedef std::vector<std::vector<float>> DistanceMatrix;
+
+#ifdef REDUCED_SIZE
+const unsigned int IMAGE_SIZE = 128; //for the regression check
+#else
+const unsigned int IMAGE_SIZE = 1024; //size of the resulting image, N * N
+#endif
+const float MAX_HEIGHT = 1024;
+const float UNKNOWN_DISTANCE = -1; //never rendered
+const float NO_DISTANCE = -2; //outside, but without a bound on the distance
+
+float toExponent(float fraction);
+std::string getFilename(float d, const std::string& extension = "dat");
+std::vector<Slice> planUniformSlices();
+std::vector<Slice> planAdaptiveSlices(unsigned int budget);
+std::vector<bool> renderProbe(float d, unsigned int size);
+void predictCosts(std::vector<Slice>& slices);
+std::vector<Slice> scheduleSlices(const std::vector<Slice>& slices, unsigned int shard, unsigned int shards);
+void writeManifest(const std::vector<Slice>& slices, std::string filename);
+void renderProgressively(const std::vector<Slice>& slices);
+Matrix2D renderLevel(const Matrix2D& coarse, unsigned int resolution, float d);
+bool isUniformAround(const Matrix2D& coarse, unsigned int x, unsigned int y);
+Matrix2D upsample(const Matrix2D& level);
+Matrix2D renderSlice(float d, DistanceMatrix& distances, bool skipExterior);
+void initializeMatrix(Matrix2D& matrix);
+void render(Chunk chunk, Matrix2D& matrix, float d);
+void renderWithDistance(Chunk chunk, Matrix2D& matrix, DistanceMatrix& distances, float d, bool skip);
+void markExterior(Chunk chunk, DistanceMatrix& distances, unsigned int centerX, unsigned int centerY, float radius);
+bool bordersAreInside(Chunk chunk, float d);
+float toFractalSpace(unsigned int pixel);
+bool isInsideFractal(float x, float y, float d);
+unsigned int countIterations(float x, float y, float d);
+float escapeDistance(float x, float y, float d, bool& inside);
+void writeDistances(DistanceMatrix& distances, std::string filename);
+void writeMatrix(Matrix2D& matrix, std::string filename);
+
+#endif
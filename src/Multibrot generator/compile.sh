@@ -1,6 +1,6 @@
 #!/bin/sh
 
-if (g++ -O3 --std=c++11 main.cpp -o multibrot) then
+if (g++ -O3 --std=c++11 main.cpp Slices.cpp Contour.cpp -o multibrot) then
     echo "Compilation success."
     exit 0
 else
@@ -1,167 +1,124 @@
-
 #include "main.hpp"
-#include "Chunk.struct"
-#include <queue>
-#include <complex>
-#include <fstream>
+#include "Contour.hpp"
 #include <iostream>
-
-
-const unsigned int CHUNK_SIZE = 32; //seems to be the fastest factor
-const unsigned int IMAGE_SIZE = 1024; //size of the resulting image, N * N
-const unsigned int MAX_DEPTH = 1024; //max iterations to follow the point
-const float MAX_HEIGHT = 1024;
+#include <cstdlib>
+#include <chrono>
+#include <cmath>
 
 
 int main(int argc, char** argv)
 {
-    for (int height = 1; height <= MAX_HEIGHT; height++)
+    std::vector<Slice> slices;
+    if (hasFlag(argc, argv, "--adaptive"))
+        slices = planAdaptiveSlices(getOption(argc, argv, "--adaptive", (unsigned int)MAX_HEIGHT));
+    else
+        slices = planUniformSlices();
+
+    std::size_t total = slices.size();
+    unsigned int shards = getOption(argc, argv, "--shards", 1);
+    unsigned int shard = getOption(argc, argv, "--shard", 1);
+    if (shard > shards)
     {
-        float d = (height / (float)MAX_HEIGHT) * 32 + 1;
-
-        std::cout << "Processing " << height << " / " << MAX_HEIGHT << " (" << d << ") ... ";
-        std::cout.flush();
-
-        std::queue<Chunk> chunks;
-        for (unsigned int x = 0; x < IMAGE_SIZE; x += CHUNK_SIZE)
-            for (unsigned int y = 0; y < IMAGE_SIZE; y += CHUNK_SIZE)
-                chunks.push(Chunk(x, y, x + CHUNK_SIZE, y + CHUNK_SIZE));
-
-        Matrix2D matrix;
-        initializeMatrix(matrix);
-
-        while (!chunks.empty())
-        {
-            //std::cout << chunks.size() << std::endl;
-            render(chunks.front(), matrix, d);
-            chunks.pop();
-        }
-
-        std::cout << "writing...";
-        std::cout.flush();
-
-        std::stringstream filename;
-        filename << "multibrot,d=" << d << ".dat";
-        writeMatrix(matrix, filename.str());
-
-        std::cout << "done" << std::endl;
-        std::cout.flush();
+        std::cout << "Shard " << shard << " does not exist, only " << shards << "!" << std::endl;
+        return EXIT_FAILURE;
     }
 
-    std::cout << "Program complete." << std::endl;
-
-    return EXIT_SUCCESS;
-}
-
+    if (shard == 1)
+        writeManifest(slices, "slices.dat");
 
-
-void initializeMatrix(Matrix2D& matrix)
-{
-    for (std::size_t j = 0; j < IMAGE_SIZE; j++)
-        matrix.push_back(std::vector<bool>(IMAGE_SIZE, 0));
-}
-
-
-
-/*
-    For each chunk, check boundaries.
-        If all black, then chunk is black
-        else complete rest of the chunk manually
-*/
-void render(Chunk chunk, Matrix2D& matrix, float d)
-{
-    if (bordersAreInside(chunk, d))
+    bool costOrder = shards > 1 || hasFlag(argc, argv, "--cost-order");
+    if (costOrder)
     {
-        for (unsigned int x = 0; x < CHUNK_SIZE; x++)
-            for (unsigned int y = 0; y < CHUNK_SIZE; y++)
-                matrix[chunk.minX_ + x][chunk.minY_ + y] = true;
-        return;
+        predictCosts(slices);
+        slices = scheduleSlices(slices, shard, shards);
     }
 
-    for (unsigned int x = 0; x < CHUNK_SIZE; x++)
-    {
-        for (unsigned int y = 0; y < CHUNK_SIZE; y++)
-        {
-            float fx = toFractalSpace(chunk.minX_ + x);
-            float fy = toFractalSpace(chunk.minY_ + y);
-            matrix[chunk.minX_ + x][chunk.minY_ + y] = isInsideFractal(fx, fy, d);
-        }
-    }
-}
+    //the previews are replaced by the slices below, with all their options
+    if (hasFlag(argc, argv, "--progressive"))
+        renderProgressively(slices);
 
+    bool skipExterior = hasFlag(argc, argv, "--distance-skip");
+    bool writeDistance = hasFlag(argc, argv, "--distance-channel");
+    bool writeContour = hasFlag(argc, argv, "--contours");
 
+    double predictedSoFar = 0, secondsSoFar = 0, errorSoFar = 0;
+    for (const auto& slice : slices)
+    {
+        std::cout << "Processing " << slice.height_ << " / " << total << " (" << slice.d_ << ") ... ";
+        std::cout.flush();
+        auto start = std::chrono::steady_clock::now();
 
-bool bordersAreInside(Chunk chunk, float d)
-{
-    bool black = true;
+        DistanceMatrix distances;
+        if (skipExterior || writeDistance)
+            distances.assign(IMAGE_SIZE, std::vector<float>(IMAGE_SIZE, UNKNOWN_DISTANCE));
 
-    for (unsigned int j = 0; black && j < CHUNK_SIZE; j++)
-        if (!isInsideFractal(toFractalSpace(chunk.minX_), toFractalSpace(chunk.minY_ + j), d))
-            black = false;
+        Matrix2D matrix = renderSlice(slice.d_, distances, skipExterior);
 
-    for (unsigned int j = 0; black && j < CHUNK_SIZE; j++)
-        if (!isInsideFractal(toFractalSpace(chunk.maxX_), toFractalSpace(chunk.minY_ + j), d))
-            black = false;
+        std::cout << "writing...";
+        std::cout.flush();
 
-    for (unsigned int j = 0; black && j < CHUNK_SIZE; j++)
-        if (!isInsideFractal(toFractalSpace(chunk.minX_ + j), toFractalSpace(chunk.minY_), d))
-            black = false;
+        writeMatrix(matrix, getFilename(slice.d_));
+        if (writeDistance)
+            writeDistances(distances, getFilename(slice.d_, "dist"));
+        if (writeContour)
+            writeContours(extractContours(matrix, slice.d_), slice.d_, getFilename(slice.d_, "contour"));
 
-    for (unsigned int j = 0; black && j < CHUNK_SIZE; j++)
-        if (!isInsideFractal(toFractalSpace(chunk.minX_ + j), toFractalSpace(chunk.maxY_), d))
-            black = false;
+        std::cout << "done";
+        if (costOrder)
+        {
+            //rate is calibrated on the slices before this one, so the check is honest
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (predictedSoFar > 0)
+            {
+                double predicted = slice.cost_ * secondsSoFar / predictedSoFar;
+                double error = (seconds - predicted) / predicted;
+                errorSoFar += std::abs(error);
+                std::cout << ", predicted " << predicted << " s, took " << seconds <<
+                    " s (" << (error * 100) << "% off)";
+            }
 
-    return black;
-}
+            predictedSoFar += slice.cost_;
+            secondsSoFar += seconds;
+        }
 
+        std::cout << std::endl;
+        std::cout.flush();
+    }
 
+    if (costOrder && slices.size() > 1)
+        std::cout << "Cost model was off by " << (errorSoFar / (double)(slices.size() - 1) * 100) <<
+            "% per slice on average." << std::endl;
 
-float toFractalSpace(unsigned int pixel)
-{
-    return 4.0f * pixel / IMAGE_SIZE - 2;
+    std::cout << "Program complete." << std::endl;
+
+    return EXIT_SUCCESS;
 }
 
 
 
-bool isInsideFractal(float x, float y, float d)
+bool hasFlag(int argc, char** argv, const std::string& flag)
 {
-    std::complex<float> c(x, y);
-    std::complex<float> z(0, 0);
-
-    unsigned int i;
-    for (i = 0; norm(z) < 4 && i < MAX_DEPTH; i++)
-        z = pow(z, d) + c;
-
-    return i == MAX_DEPTH;
+    for (int j = 1; j < argc; j++)
+        if (flag == argv[j])
+            return true;
+    return false;
 }
 
 
 
-void writeMatrix(Matrix2D& matrix, std::string filename)
+//returns the number following the flag, or the default if it is absent
+unsigned int getOption(int argc, char** argv, const std::string& flag, unsigned int defaultValue)
 {
-    std::ofstream fout;
-    fout.open(filename, std::ofstream::out);
-
-    for (const auto &row : matrix)
+    for (int j = 1; j + 1 < argc; j++)
     {
-        bool state = false;
-        int count = 0;
-
-        for (int index = 0; index < row.size(); index++)
+        if (flag == argv[j])
         {
-            if (row[index] == state)
-                count++;
-            else
-            {
-                fout << count << " ";
-                count = 1;
-                state = !state;
-            }
+            char* end;
+            unsigned long value = std::strtoul(argv[j + 1], &end, 10);
+            if (*end == '\0' && value > 0)
+                return (unsigned int)value;
         }
-
-        fout << count << " ";
-        fout << std::endl;
     }
 
-    fout.close();
+    return defaultValue;
 }
@@ -0,0 +1,106 @@
+
+/******************************************************************************\
+                     This file is part of Multibrot Renderer,
+          a program that displays 3D views of the Multibrot fractal
+
+                      Copyright (c) 2013, Jesse Victors
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see http://www.gnu.org/licenses/
+
+                For information regarding this software email:
+                                Jesse Victors
+                         jvictors@jessevictors.com
+\******************************************************************************/
+
+#include "FadeBuffer.hpp"
+
+
+FadeBuffer::FadeBuffer() :
+    from_(0), to_(1), rangeUniform_(-1)
+{}
+
+
+
+// Keep the fragments whose pattern value lies in [from, to)
+void FadeBuffer::setRange(float from, float to)
+{
+    from_ = from;
+    to_ = to;
+}
+
+
+
+void FadeBuffer::store(GLuint programHandle)
+{
+    rangeUniform_ = glGetUniformLocation(programHandle, "fadeRange");
+}
+
+
+
+void FadeBuffer::enable()
+{
+    glUniform2f(rangeUniform_, from_, to_);
+}
+
+
+
+void FadeBuffer::disable()
+{}
+
+
+
+SnippetPtr FadeBuffer::getVertexShaderGLSL()
+{
+    return std::make_shared<ShaderSnippet>(
+        R".(
+            //FadeBuffer fields
+        ).",
+        R".(
+            //FadeBuffer methods
+        ).",
+        R".(
+            //FadeBuffer main method code
+        )."
+    );
+}
+
+
+
+SnippetPtr FadeBuffer::getFragmentShaderGLSL()
+{
+    return std::make_shared<ShaderSnippet>(
+        R".(
+            //FadeBuffer fields
+            uniform vec2 fadeRange; //of the dither values kept
+        ).",
+        R".(
+            //FadeBuffer methods
+            float getDither(vec2 pixel)
+            {
+                //4x4 ordered dither, so a fade looks even rather than noisy
+                vec2 cell = mod(floor(pixel), 4.0);
+                float a = mod(cell.x, 2.0), b = mod(cell.y, 2.0);
+                float c = floor(cell.x / 2.0), e = floor(cell.y / 2.0);
+                float value = 8.0 * mod(a + b, 2.0) + 4.0 * b + 2.0 * mod(c + e, 2.0) + e;
+                return (value + 0.5) / 16.0;
+            }
+        ).",
+        R".(
+            //FadeBuffer main method code
+            float dither = getDither(gl_FragCoord.xy);
+            if (dither < fadeRange.x || dither >= fadeRange.y)
+                discard;
+        )."
+    );
+}
@@ -0,0 +1,61 @@
+
+/******************************************************************************\
+                     This file is part of Multibrot Renderer,
+          a program that displays 3D views of the Multibrot fractal
+
+                      Copyright (c) 2013, Jesse Victors
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see http://www.gnu.org/licenses/
+
+                For information regarding this software email:
+                                Jesse Victors
+                         jvictors@jessevictors.com
+\******************************************************************************/
+
+#ifndef FADE_BUFFER
+#define FADE_BUFFER
+
+/**
+    A FadeBuffer lets a Model show only part of its fragments, chosen by a
+    fixed dither pattern over the screen, so that two levels of detail can
+    be cross-faded without sorting or blending. One level keeps the pattern
+    values below the fade and the other keeps the rest, which together
+    cover every pixel exactly once. The pattern follows the screen rather
+    than the geometry, so each pixel switches level just once in a fade.
+**/
+
+#include "OptionalDataBuffer.hpp"
+#include <memory>
+
+class FadeBuffer : public OptionalDataBuffer
+{
+    public:
+        FadeBuffer();
+        void setRange(float from, float to);
+
+        virtual void store(GLuint programHandle);
+        virtual void enable();
+        virtual void disable();
+
+        virtual SnippetPtr getVertexShaderGLSL();
+        virtual SnippetPtr getFragmentShaderGLSL();
+
+    private:
+        float from_, to_;
+        GLint rangeUniform_;
+};
+
+typedef std::shared_ptr<FadeBuffer> FadePtr;
+
+#endif
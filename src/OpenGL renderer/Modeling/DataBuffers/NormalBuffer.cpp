@@ -0,0 +1,110 @@
+
+/******************************************************************************\
+                     This file is part of Multibrot Renderer,
+          a program that displays 3D views of the Multibrot fractal
+
+                      Copyright (c) 2013, Jesse Victors
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see http://www.gnu.org/licenses/
+
+                For information regarding this software email:
+                                Jesse Victors
+                         jvictors@jessevictors.com
+\******************************************************************************/
+
+#include "NormalBuffer.hpp"
+
+
+NormalBuffer::NormalBuffer(const std::vector<glm::vec3>& normals) :
+    normals_(normals)
+{}
+
+
+
+std::vector<glm::vec3> NormalBuffer::getNormals()
+{
+    return normals_;
+}
+
+
+
+// Store the normals in a GPU buffer
+void NormalBuffer::store(GLuint programHandle)
+{
+    glGenBuffers(1, &normalBuffer_);
+    normalAttrib_ = glGetAttribLocation(programHandle, "vertexNormal");
+
+    glBindBuffer(GL_ARRAY_BUFFER, normalBuffer_);
+    glBufferData(GL_ARRAY_BUFFER, normals_.size() * sizeof(glm::vec3),
+        normals_.data(), GL_STATIC_DRAW);
+}
+
+
+
+void NormalBuffer::enable()
+{
+    glEnableVertexAttribArray(normalAttrib_);
+    glBindBuffer(GL_ARRAY_BUFFER, normalBuffer_);
+    glVertexAttribPointer(normalAttrib_, 3, GL_FLOAT, GL_FALSE, 0, 0);
+}
+
+
+
+void NormalBuffer::disable()
+{
+    glDisableVertexAttribArray(normalAttrib_);
+}
+
+
+
+SnippetPtr NormalBuffer::getVertexShaderGLSL()
+{
+    return std::make_shared<ShaderSnippet>(
+        R".(
+            //NormalBuffer fields
+            attribute vec3 vertexNormal;
+            varying vec3 vertexNormalBlend;
+        ).",
+        R".(
+            //NormalBuffer methods
+        ).",
+        R".(
+            //NormalBuffer main method code
+            vertexNormalBlend = vertexNormal;
+        )."
+    );
+}
+
+
+
+SnippetPtr NormalBuffer::getFragmentShaderGLSL()
+{
+    return std::make_shared<ShaderSnippet>(
+        R".(
+            //NormalBuffer fields
+            varying vec3 vertexNormalBlend;
+        ).",
+        R".(
+            //NormalBuffer methods
+        ).",
+        R".(
+            //NormalBuffer main method code
+            vec3 lightDirection = normalize(vec3(0.3, 0.5, 0.8));
+            float facing = 1.0; //zero normals have no direction to shade by
+            if (length(vertexNormalBlend) > 0.001)
+                facing = max(dot(normalize(vertexNormalBlend), lightDirection), 0.0);
+            colors.material *= 0.35 + 0.65 * facing;
+        )."
+    );
+}
@@ -0,0 +1,63 @@
+
+/******************************************************************************\
+                     This file is part of Multibrot Renderer,
+          a program that displays 3D views of the Multibrot fractal
+
+                      Copyright (c) 2013, Jesse Victors
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see http://www.gnu.org/licenses/
+
+                For information regarding this software email:
+                                Jesse Victors
+                         jvictors@jessevictors.com
+\******************************************************************************/
+
+#ifndef NORMAL_BUFFER
+#define NORMAL_BUFFER
+
+/**
+    A NormalBuffer gives each vertex in a Mesh the direction its surface
+    faces. Meshes built from boxes don't need one, but a smooth surface
+    such as the converter's triangle mesh does, or every face would be
+    shaded the same. The fragment shader darkens the material color of
+    faces that turn away from a fixed light direction.
+**/
+
+#include "OptionalDataBuffer.hpp"
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+class NormalBuffer : public OptionalDataBuffer
+{
+    public:
+        NormalBuffer(const std::vector<glm::vec3>& normals);
+        std::vector<glm::vec3> getNormals();
+
+        virtual void store(GLuint programHandle);
+        virtual void enable();
+        virtual void disable();
+
+        virtual SnippetPtr getVertexShaderGLSL();
+        virtual SnippetPtr getFragmentShaderGLSL();
+
+    private:
+        std::vector<glm::vec3> normals_;
+        GLuint normalBuffer_;
+        GLint normalAttrib_;
+};
+
+typedef std::shared_ptr<NormalBuffer> NormalPtr;
+
+#endif
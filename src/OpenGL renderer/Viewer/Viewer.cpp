@@ -33,19 +33,28 @@
 #include "Modeling/DataBuffers/SampledBuffers/TexturedCube.hpp"
 #include "Modeling/DataBuffers/SampledBuffers/TexturedPlane.hpp"
 #include "Modeling/DataBuffers/ColorBuffer.hpp"
+#include "Modeling/DataBuffers/NormalBuffer.hpp"
+#include "Modeling/DataBuffers/FadeBuffer.hpp"
 #include "glm/gtx/transform.hpp"
+#include "Modeling/Shading/ShaderManager.hpp"
+#include "GeometryFile.hpp"
 #include <thread>
+#include <map>
 #include <algorithm>
 #include <iterator>
 #include <sstream>
 #include <iostream>
+#include <fstream>
+#include <cstdint>
+#include <cmath>
 #include <math.h>
 
 
 Viewer::Viewer() :
     scene_(std::make_shared<Scene>(createCamera())),
     user_(std::make_shared<User>(scene_)),
-    timeSpentRendering_(0), frameCount_(0), needsRerendering_(true)
+    timeSpentRendering_(0), frameCount_(0), screenHeight_(glutGet(GLUT_WINDOW_HEIGHT)),
+    needsRerendering_(true)
 {
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_CULL_FACE);
@@ -171,70 +180,299 @@ void Viewer::addFractal()
     static const auto SCALE = glm::vec3(1 / 64.0f);
     static const auto POS = glm::vec3(30, 30, -3);
     static const auto BOX_SCALE = glm::vec3(1.0f);
+    static const int VOLUME_SIZE = 1024, BRICK_SIZE = 64; //for text geometry, which has no bricks
 
-    std::vector<std::pair<int, std::shared_ptr<std::vector<glm::mat4>>>> boxTypes;
-    for (int j = 128; j >= 1; j /= 2)
-        boxTypes.push_back(std::make_pair(j, std::make_shared<std::vector<glm::mat4>>()));
+    if (addFractalSurface("geometry.mesh", SCALE, POS))
+        return; //the converter wrote a surface instead of boxes
 
-    long count = 0;
-    auto geometry = readGeometry("geometry.dat");
-    for (auto rectangle : geometry)
+    //each brick becomes one model per level, so that it can be culled and swapped as a unit
+    std::map<std::size_t, std::vector<std::vector<glm::mat4>>> brickBoxes;
+    std::map<std::size_t, std::pair<glm::vec3, glm::vec3>> brickBounds;
+
+    std::vector<long> counts;
+    auto exponents = readSliceExponents("slices.dat");
+    auto addBox = [&](std::size_t level, std::size_t brick, int d0, int x0, int y0, int d1, int x1, int y1)
     {
-        glm::vec3 min = glm::vec3(rectangle[1], rectangle[2], rectangle[3]);
-        glm::vec3 max = glm::vec3(rectangle[4], rectangle[5], rectangle[6]);
-        glm::vec3 size = max - min;
-        float minDimSize = std::min(size.x, std::min(size.y, size.z));
+        //slices may be spaced unevenly in d, so place layers by their exponent
+        glm::vec3 min = glm::vec3(toLayerPosition(exponents, d0), x0, y0);
+        glm::vec3 max = glm::vec3(toLayerPosition(exponents, d1), x1, y1);
+
+        auto matrix = glm::scale(glm::mat4(), SCALE);
+        matrix      = glm::translate(matrix, min - glm::vec3(512));
+        matrix      = glm::scale(matrix, (max - min) * BOX_SCALE);
+        matrix      = glm::translate(matrix, glm::vec3(0.5f));
+
+        auto& levels = brickBoxes[brick];
+        if (levels.size() <= level)
+            levels.resize(level + 1);
+        levels[level].push_back(matrix);
+        if (counts.size() <= level)
+            counts.resize(level + 1, 0);
+        counts[level]++;
+
+        glm::vec3 low = SCALE * (min - glm::vec3(512)), high = SCALE * (max - glm::vec3(512));
+        auto bounds = brickBounds.find(brick);
+        if (bounds == brickBounds.end())
+            brickBounds[brick] = std::make_pair(low, high);
+        else
+            bounds->second = std::make_pair(glm::min(bounds->second.first, low),
+                glm::max(bounds->second.second, high));
+    };
+
+    //bricks are matched across levels by position, not by their place in each index
+    auto addLevel = [&](const GeometryFile& file, std::size_t level)
+    {
+        const GeometryHeader& header = file.getHeader();
+        for (std::size_t j = 0; j < file.getBrickCount(); j++)
+        {
+            const BrickEntry& entry = file.getBricks()[j];
+            std::size_t brick = getBrickIndex(entry.bounds_, header.size_, header.brickSize_);
+            const BoxRecord* boxes = file.getBrickBoxes(entry);
+            for (std::size_t k = 0; k < entry.boxCount_; k++)
+                addBox(level, brick, boxes[k].d0_, boxes[k].x0_, boxes[k].y0_,
+                    boxes[k].d1_, boxes[k].x1_, boxes[k].y1_);
+        }
+    };
 
-        for (auto boxType : boxTypes)
+    //the binary geometry is mapped in place, the text is the fallback
+    GeometryFile binary(getLevelFilename(0));
+    if (binary.isOpen())
+    {
+        addLevel(binary, 0);
+        std::cout << "Mapped " << binary.getBoxCount() << " objects from file." << std::endl;
+    }
+    else
+    {
+        //cut like the binary boxes, so the bricks can still switch to coarser levels on their own
+        for (auto rectangle : readGeometry("geometry.dat"))
         {
-            if ((int)minDimSize == boxType.first)
+            BoxRecord box = { (std::int16_t)rectangle[1], (std::int16_t)rectangle[2], (std::int16_t)rectangle[3],
+                (std::int16_t)rectangle[4], (std::int16_t)rectangle[5], (std::int16_t)rectangle[6] };
+            splitAtBricks(box, BRICK_SIZE, [&](const BoxRecord& part) {
+                addBox(0, getBrickIndex(part, VOLUME_SIZE, BRICK_SIZE), part.d0_, part.x0_, part.y0_,
+                    part.d1_, part.x1_, part.y1_);
+            });
+        }
+    }
+
+    //coarser levels come only in binary, up to the first one missing
+    for (std::size_t level = 1; ; level++)
+    {
+        GeometryFile coarse(getLevelFilename(level));
+        if (!coarse.isOpen())
+            break;
+        addLevel(coarse, level);
+    }
+
+    for (std::size_t level = 0; level < counts.size(); level++)
+        std::cout << "Level " << level << " instance count: " << counts[level] << std::endl;
+    std::cout << "In " << brickBoxes.size() << " bricks" << std::endl;
+
+    //the bricks share one program, as they have the same buffers
+    auto mesh = TexturedCube::getExternalFacingMesh();
+    auto vertices = mesh->getVertexBuffer()->getVertices();
+    ProgramPtr program;
+    for (auto& brick : brickBoxes)
+    {
+        const auto& bounds = brickBounds[brick.first];
+        FractalBrick fractalBrick(bounds.first, bounds.second);
+        for (const auto& boxes : brick.second)
+        {
+            if (boxes.empty())
+            {
+                fractalBrick.levels.push_back(nullptr);
+                fractalBrick.fades.push_back(nullptr);
+                continue;
+            }
+
+            std::vector<glm::vec3> vertexColors;
+            for (auto modelMatrix : boxes)
             {
-                auto matrix = glm::scale(glm::mat4(), SCALE);
-                matrix      = glm::translate(matrix, min - glm::vec3(512));
-                matrix      = glm::scale(matrix, (max - min) * BOX_SCALE);
-                matrix      = glm::translate(matrix, glm::vec3(0.5f));
-                boxType.second->push_back(matrix);
-                count++;
-                break;
+                for (auto vertex : vertices)
+                    vertexColors.push_back(getFractalColor((modelMatrix * glm::vec4(vertex, 1)).xyz()));
             }
+
+            auto fade = std::make_shared<FadeBuffer>();
+            BufferList list = { std::make_shared<ColorBuffer>(vertexColors), fade };
+            auto model = std::make_shared<InstancedModel>(mesh, boxes, list);
+
+            model->unify(glm::rotate(glm::translate(POS), 0.0f, glm::vec3(0, 1, 0)));
+            //model->setAffectedByLight(false);
+            fractalBrick.levels.push_back(model);
+            fractalBrick.fades.push_back(fade);
+
+            if (!program)
+                program = ShaderManager::createProgram(model, scene_->getVertexShaderGLSL(),
+                    scene_->getFragmentShaderGLSL(), scene_->getLightManager());
+            scene_->addModel(model, program); //add to Scene and save
         }
+
+        fractalBricks_.push_back(fractalBrick);
     }
+}
 
-    std::cout << "Instance count: " << count << std::endl;
-    for (auto boxType : boxTypes)
-        std::cout << boxType.first << ", " << boxType.second->size() << std::endl;
 
-    auto mesh = TexturedCube::getExternalFacingMesh();
-    for (auto boxType : boxTypes)
+
+/*
+    Hides the bricks of the fractal that are entirely outside the camera's
+    view, and shows each of the others at the coarsest level whose voxels
+    still come out no larger than a couple of pixels. Over the last part of
+    each halving a brick cross-fades into the next level, so detail is not
+    swapped all at once. The boxes drawn then depend on the fractal's size
+    on screen rather than on the full geometry.
+*/
+void Viewer::selectFractalLevels()
+{
+    static const float VOXEL_SIZE = 1 / 64.0f; //in model space, as addFractal scales them
+    static const float MAX_VOXEL_PIXELS = 2;
+    static const float FADE_BAND = 0.25f; //of each halving
+
+    auto camera = scene_->getCamera();
+    for (auto& brick : fractalBricks_)
     {
-        if (boxType.second->size() == 0)
-            continue;
+        glm::mat4 matrix = getFractalBrickMatrix(brick);
+        bool visible = camera->canSee(matrix, brick.min, brick.max);
 
-        std::vector<glm::vec3> vertexColors;
-        auto vertices = mesh->getVertexBuffer()->getVertices();
-        for (auto modelMatrix : *boxType.second)
+        float detail = 0; //0 for the finest level, 1 for the next, and in between while fading
+        if (visible && brick.levels.size() > 1)
         {
-            for (auto vertex : vertices)
-            {
-                float r = 0, g = 0, b = 0;
-                auto newV = (modelMatrix * glm::vec4(vertex, 1)).xyz();
-                auto radius = (float)sqrt(std::pow(newV.y, 2) + std::pow(newV.z, 2));
+            float pixels = camera->getProjectedScale(matrix, (brick.min + brick.max) * 0.5f) *
+                (float)screenHeight_ * VOXEL_SIZE;
+            detail = std::log2(MAX_VOXEL_PIXELS / std::max(pixels, 1e-6f));
+            detail = glm::clamp(detail, 0.0f, (float)(brick.levels.size() - 1));
+        }
 
-                r = g = (radius - 2.4f) / 3.5f, b = 1;
-                g = std::max(g, (-newV.x - 6.9f) / 1.5f);
+        auto level = (std::size_t)detail;
+        float fade = glm::clamp((detail - (float)level - (1 - FADE_BAND)) / FADE_BAND, 0.0f, 1.0f);
+        for (std::size_t j = 0; j < brick.levels.size(); j++)
+        {
+            if (!brick.levels[j])
+                continue;
 
-                vertexColors.push_back(glm::vec3(r, g, b));
+            bool shown = visible && (j == level || (j == level + 1 && fade > 0));
+            brick.levels[j]->setVisible(shown);
+            if (j < brick.fades.size() && brick.fades[j])
+            {
+                if (j == level)
+                    brick.fades[j]->setRange(fade, 1);
+                else
+                    brick.fades[j]->setRange(0, fade);
             }
         }
+    }
+}
+
+
+
+//the levels of a brick all move together, so any one of them has the brick's matrix
+glm::mat4 Viewer::getFractalBrickMatrix(const FractalBrick& brick)
+{
+    for (const auto& model : brick.levels)
+        if (model)
+            return model->getModelMatrix(0);
+    return glm::mat4();
+}
+
+
+
+/*
+    Loads the triangle mesh that the converter writes with --mesh, returning
+    false if there is none. Its vertices are in voxels, so they are placed
+    along d by slice exponent like the boxes are, then scaled to match them.
+*/
+bool Viewer::addFractalSurface(const std::string& filename, const glm::vec3& scale,
+    const glm::vec3& position)
+{
+    std::vector<glm::vec3> vertices, normals;
+    std::vector<GLuint> indices;
+    if (!readSurface(filename, vertices, normals, indices))
+        return false;
+
+    auto exponents = readSliceExponents("slices.dat");
+    std::vector<glm::vec3> vertexColors;
+    vertexColors.reserve(vertices.size());
+    for (auto& vertex : vertices)
+    {
+        int layer = (int)std::floor(vertex.x);
+        float below = toLayerPosition(exponents, layer);
+        float above = toLayerPosition(exponents, layer + 1);
+        vertex.x = below + (above - below) * (vertex.x - (float)layer);
+
+        vertex = (vertex - glm::vec3(512)) * scale;
+        vertexColors.push_back(getFractalColor(vertex));
+    }
+
+    auto mesh = std::make_shared<Mesh>(std::make_shared<VertexBuffer>(vertices),
+        std::make_shared<IndexBuffer>(indices, GL_TRIANGLES), GL_TRIANGLES);
+    BufferList list = { std::make_shared<ColorBuffer>(vertexColors),
+        std::make_shared<NormalBuffer>(normals) };
+    auto model = std::make_shared<InstancedModel>(mesh,
+        glm::rotate(glm::translate(position), 0.0f, glm::vec3(0, 1, 0)), list);
+
+    std::cout << "Surface has " << vertices.size() << " vertices and " <<
+        indices.size() / 3 << " triangles." << std::endl;
+
+    glm::vec3 min = vertices.empty() ? glm::vec3() : vertices[0], max = min;
+    for (const auto& vertex : vertices)
+        min = glm::min(min, vertex), max = glm::max(max, vertex);
+
+    FractalBrick brick(min, max);
+    brick.levels.push_back(model);
+    fractalBricks_.push_back(brick);
+    scene_->addModel(model);
+    return true;
+}
 
-        BufferList list = { std::make_shared<ColorBuffer>(vertexColors) };
-        auto model = std::make_shared<InstancedModel>(mesh, *boxType.second, list);
 
-        model->unify(glm::rotate(glm::translate(POS), 0.0f, glm::vec3(0, 1, 0)));
-        //model->setAffectedByLight(false);
-        boxTypes_.push_back(model);
-        scene_->addModel(model); //add to Scene and save
+
+//blue, fading to white away from the d axis and at low exponents
+glm::vec3 Viewer::getFractalColor(const glm::vec3& vertex)
+{
+    float r = 0, g = 0, b = 0;
+    auto radius = (float)sqrt(std::pow(vertex.y, 2) + std::pow(vertex.z, 2));
+
+    r = g = (radius - 2.4f) / 3.5f, b = 1;
+    g = std::max(g, (-vertex.x - 6.9f) / 1.5f);
+
+    return glm::vec3(r, g, b);
+}
+
+
+
+//reads the binary layout described in the converter's SurfaceMesh::write
+bool Viewer::readSurface(const std::string& filename, std::vector<glm::vec3>& vertices,
+    std::vector<glm::vec3>& normals, std::vector<GLuint>& indices)
+{
+    std::ifstream file;
+    file.open(filename, std::ifstream::in | std::ifstream::binary);
+    if (file.fail())
+        return false;
+
+    char magic[4];
+    std::uint32_t vertexCount = 0, indexCount = 0;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&vertexCount), sizeof(vertexCount));
+    file.read(reinterpret_cast<char*>(&indexCount), sizeof(indexCount));
+    if (!file || std::string(magic, sizeof(magic)) != "MBM1")
+    {
+        std::cout << "\"" << filename << "\" is not a surface mesh!" << std::endl;
+        return false;
+    }
+
+    vertices.resize(vertexCount);
+    normals.resize(vertexCount);
+    indices.resize(indexCount);
+    file.read(reinterpret_cast<char*>(vertices.data()), (std::streamsize)(vertexCount * sizeof(glm::vec3)));
+    file.read(reinterpret_cast<char*>(normals.data()), (std::streamsize)(vertexCount * sizeof(glm::vec3)));
+    file.read(reinterpret_cast<char*>(indices.data()), (std::streamsize)(indexCount * sizeof(GLuint)));
+    if (!file)
+    {
+        std::cout << "\"" << filename << "\" is truncated!" << std::endl;
+        return false;
     }
+
+    file.close();
+    return true;
 }
 
 
@@ -266,6 +504,59 @@ std::vector<std::vector<int>> Viewer::readGeometry(const std::string& filename)
 
 
 
+std::vector<float> Viewer::readSliceExponents(const std::string& filename)
+{
+    std::vector<float> exponents;
+
+    std::ifstream file;
+    file.open(filename, std::ifstream::in);
+    if (file.fail())
+    {
+        std::cout << "No slice manifest, assuming evenly spaced layers." << std::endl;
+        return exponents;
+    }
+
+    std::string line;
+    while (getline(file, line))
+    {
+        std::istringstream is(line);
+        int height;
+        float d;
+        if (is >> height >> d)
+            exponents.push_back(d);
+    }
+
+    file.close();
+
+    std::cout << "Read " << exponents.size() << " slice exponents." << std::endl;
+
+    return exponents;
+}
+
+
+
+/*
+    Maps a layer boundary to its position along the d axis, scaled so that
+    evenly spaced slices land exactly on their layer index. The boundary past
+    the last layer continues the spacing of the final pair.
+*/
+float Viewer::toLayerPosition(const std::vector<float>& exponents, int layer)
+{
+    if (exponents.size() < 2)
+        return layer;
+
+    auto last = exponents.size() - 1;
+    float d;
+    if ((std::size_t)layer <= last)
+        d = exponents[(std::size_t)layer];
+    else
+        d = exponents[last] + (exponents[last] - exponents[last - 1]) * (float)((std::size_t)layer - last);
+
+    return (d - exponents.front()) / (exponents.back() - exponents.front()) * (float)last;
+}
+
+
+
 void Viewer::addSkybox()
 {
     /*
@@ -317,11 +608,16 @@ void Viewer::animate(int deltaTime)
 
     bool animationHappened = false;
 
-    for (auto boxType : boxTypes_)
+    for (auto& brick : fractalBricks_)
     {
-        auto matrix = boxType->getModelMatrix(0);
-        matrix = glm::rotate(matrix, deltaTime * ROT_SPEED, glm::vec3(1, 0, 0));
-        boxType->setModelMatrix(0, matrix);
+        for (auto& model : brick.levels)
+        {
+            if (!model)
+                continue;
+            auto matrix = model->getModelMatrix(0);
+            matrix = glm::rotate(matrix, deltaTime * ROT_SPEED, glm::vec3(1, 0, 0));
+            model->setModelMatrix(0, matrix);
+        }
     }
 
     auto lights = scene_->getLightManager()->getLights();
@@ -354,6 +650,7 @@ void Viewer::render()
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
     glClearColor(255 / 255.0f, 249 / 255.0f, 253 / 255.0f, 1);
 
+    selectFractalLevels();
     timeSpentRendering_ += scene_->render();
     frameCount_++;
 
@@ -365,6 +662,7 @@ void Viewer::render()
 void Viewer::handleWindowReshape(int newWidth, int newHeight)
 {
     scene_->getCamera()->setAspectRatio(newWidth / (float)newHeight);
+    screenHeight_ = newHeight;
     user_->setWindowOffset(glutGet(GLUT_WINDOW_X), glutGet(GLUT_WINDOW_Y));
     //needsRerendering_ = true; //need to redraw after window update
 
@@ -27,6 +27,7 @@
 #define VIEWER
 
 #include "User.hpp"
+#include "FractalBrick.struct"
 #include "World/Scene.hpp"
 #include <memory>
 
@@ -47,8 +48,17 @@ class Viewer
         void addModels();
         void addBellCurveBlocks();
         void addFractal();
+        void selectFractalLevels();
+        glm::mat4 getFractalBrickMatrix(const FractalBrick& brick);
+        bool addFractalSurface(const std::string& filename, const glm::vec3& scale,
+            const glm::vec3& position);
+        glm::vec3 getFractalColor(const glm::vec3& vertex);
+        bool readSurface(const std::string& filename, std::vector<glm::vec3>& vertices,
+            std::vector<glm::vec3>& normals, std::vector<GLuint>& indices);
         void addSkybox();
         std::vector<std::vector<int>> readGeometry(const std::string& filename);
+        std::vector<float> readSliceExponents(const std::string& filename);
+        float toLayerPosition(const std::vector<float>& exponents, int layer);
         std::shared_ptr<Mesh> getInternalFacingCube();
         std::shared_ptr<Mesh> getExternalFacingCube();
         std::shared_ptr<Camera> createCamera();
@@ -58,9 +68,9 @@ class Viewer
 
         std::shared_ptr<Scene> scene_;
         std::shared_ptr<User> user_;
-        std::vector<std::shared_ptr<InstancedModel>> boxTypes_;
+        std::vector<FractalBrick> fractalBricks_;
         float timeSpentRendering_;
-        int frameCount_;
+        int frameCount_, screenHeight_;
         bool needsRerendering_;
 };
 
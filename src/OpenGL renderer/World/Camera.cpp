@@ -30,6 +30,7 @@
 #include <sstream>
 #include <stdexcept>
 #include <iostream>
+#include <cmath>
 
 
 Camera::Camera() :
@@ -396,6 +397,61 @@ glm::mat4 Camera::getProjectionMatrix() const
 
 
 
+/*
+    Tests a model-space bounding box against the frustrum. The box is hidden
+    only if all eight of its corners lie beyond the same clipping plane, so
+    a few boxes near the frustrum's corners are kept that could be culled.
+*/
+bool Camera::canSee(const glm::mat4& modelMatrix, const glm::vec3& min,
+                    const glm::vec3& max) const
+{
+    glm::mat4 mvp = projection_ * calculateViewMatrix() * modelMatrix;
+
+    int outside[6] = { 0, 0, 0, 0, 0, 0 };
+    for (int corner = 0; corner < 8; corner++)
+    {
+        glm::vec4 point = mvp * glm::vec4(
+            corner & 1 ? max.x : min.x,
+            corner & 2 ? max.y : min.y,
+            corner & 4 ? max.z : min.z, 1);
+
+        outside[0] += point.x < -point.w;
+        outside[1] += point.x > point.w;
+        outside[2] += point.y < -point.w;
+        outside[3] += point.y > point.w;
+        outside[4] += point.z < -point.w;
+        outside[5] += point.z > point.w;
+    }
+
+    for (int plane = 0; plane < 6; plane++)
+        if (outside[plane] == 8)
+            return false;
+    return true;
+}
+
+
+
+/*
+    Returns the fraction of the screen's height that one unit of model space
+    spans around the given point, for choosing how much detail is worth
+    drawing there. Points at or behind the camera span the whole screen.
+*/
+float Camera::getProjectedScale(const glm::mat4& modelMatrix,
+                                const glm::vec3& point) const
+{
+    static const float PI = 3.1415926f;
+
+    glm::vec4 viewed = calculateViewMatrix() * modelMatrix * glm::vec4(point, 1);
+    float distance = -viewed.z;
+    if (distance <= nearFieldClip_)
+        return 1;
+
+    float unit = glm::length(glm::vec3(modelMatrix[0])); //of a uniformly scaled model
+    return unit / (2 * distance * std::tan(fieldOfView_ * PI / 360));
+}
+
+
+
 std::string Camera::toString() const
 {
     std::stringstream ss;
@@ -99,6 +99,10 @@ class Camera
         float getNearFieldClip() const;
         float getFarFieldClip() const;
         glm::mat4 getProjectionMatrix() const;
+        bool canSee(const glm::mat4& modelMatrix, const glm::vec3& min,
+                    const glm::vec3& max) const;
+        float getProjectedScale(const glm::mat4& modelMatrix,
+                                const glm::vec3& point) const;
 
         std::string toString() const;
 
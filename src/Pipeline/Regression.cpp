@@ -0,0 +1,490 @@
+
+#include "Regression.hpp"
+#include "Components.hpp"
+#include "Parallel.hpp"
+#include "Octree.hpp"
+#include "Greedy.hpp"
+#include "IntervalVolume.hpp"
+#include "SlabStream.hpp"
+#include "SliceReader.hpp"
+#include <sys/stat.h>
+#include <functional>
+#include <stdexcept>
+#include <algorithm>
+#include <numeric>
+#include <complex>
+#include <array>
+#include <tuple>
+#include <sstream>
+#include <iostream>
+#include <cstdlib>
+#include <cstdio>
+
+
+const unsigned int HEIGHTS = 64; //of the reduced stack, of which a subset is rendered
+const unsigned int REFERENCE_DEPTH = 1024; //the generator's iteration limit
+const unsigned int PREVIEW_RESOLUTION = 64; //the generator's first progressive level
+const double MAX_BOUNDARY_MISMATCH = 0.02; //of the boundary pixels, for inexact renderings
+const std::size_t MIN_BOX_SIZE = 4;
+const std::size_t SLAB_HEIGHT = 8; //for the streamed conversion, to have seams to cross
+const std::size_t STREAM_BUDGET = 192 << 10; //a few layers at a time, so slabs get measured and shrunk
+const std::size_t LEVEL_CHECKS = 4; //the full geometry and three halvings, like the converter writes
+const std::size_t WRITE_BUFFER = 16; //records, so the binary geometry is written in many passes
+const char* const SLICE_DIRECTORY = "regression_slices";
+
+
+int main(int argc, char** argv)
+{
+    setThreadCount(getOption(argc, argv, "--threads", 0));
+    unsigned int step = HEIGHTS / std::min(getOption(argc, argv, "--heights", 16), HEIGHTS);
+    std::vector<float> exponents;
+    for (unsigned int height = step; height <= HEIGHTS; height += step)
+        exponents.push_back(toExponent(height / (float)HEIGHTS));
+
+    std::cout << "Rendering " << exponents.size() << " reference slices of " << IMAGE_SIZE <<
+        "x" << IMAGE_SIZE << "... ";
+    std::cout.flush();
+    std::vector<Matrix2D> reference(exponents.size());
+    runInParallel(exponents.size(), [&](std::size_t j) {
+        reference[j] = renderReference(exponents[j]);
+    });
+    std::cout << "done." << std::endl;
+
+    //plain renderings, with the chunk border shortcut but without distances
+    std::vector<Matrix2D> plain(exponents.size());
+    runInParallel(exponents.size(), [&](std::size_t j) {
+        DistanceMatrix distances; //none, so every pixel is rendered
+        plain[j] = renderSlice(exponents[j], distances, false);
+    });
+
+    bool passed = true;
+    auto compare = [&](const std::string& check, const std::vector<Matrix2D>& expected, bool exact,
+        const std::function<Matrix2D(std::size_t j)>& render) {
+        std::vector<std::size_t> mismatched(exponents.size()), boundary(exponents.size());
+        runInParallel(exponents.size(), [&](std::size_t j) {
+            mismatched[j] = countMismatches(render(j), expected[j]);
+            boundary[j] = countBoundary(expected[j]);
+        });
+
+        std::size_t mismatches = std::accumulate(mismatched.begin(), mismatched.end(), (std::size_t)0);
+        std::size_t edges = std::accumulate(boundary.begin(), boundary.end(), (std::size_t)0);
+        double fraction = edges > 0 ? (double)mismatches / (double)edges : 0;
+        std::stringstream detail("");
+        detail << mismatches << " pixels differ, " << 100 * fraction << "% of the boundary";
+        passed &= report(check, exact ? mismatches == 0 : fraction <= MAX_BOUNDARY_MISMATCH, detail.str());
+    };
+
+    compare("isInsideFractal", reference, true, [&](std::size_t j) {
+        Matrix2D matrix;
+        initializeMatrix(matrix);
+        for (unsigned int x = 0; x < IMAGE_SIZE; x++)
+            for (unsigned int y = 0; y < IMAGE_SIZE; y++)
+                matrix[x][y] = isInsideFractal(toFractalSpace(x), toFractalSpace(y), exponents[j]);
+        return matrix;
+    });
+    compare("chunk borders", reference, false, [&](std::size_t j) {
+        return plain[j];
+    });
+
+    //distances only add a channel and skip pixels they prove outside, so they match the plain rendering
+    compare("distance channel", plain, true, [&](std::size_t j) {
+        DistanceMatrix distances(IMAGE_SIZE, std::vector<float>(IMAGE_SIZE, UNKNOWN_DISTANCE));
+        return renderSlice(exponents[j], distances, false);
+    });
+    compare("distance skip", plain, true, [&](std::size_t j) {
+        DistanceMatrix distances(IMAGE_SIZE, std::vector<float>(IMAGE_SIZE, UNKNOWN_DISTANCE));
+        return renderSlice(exponents[j], distances, true);
+    });
+
+    //the generator's last preview level, on every other pixel of the reference
+    std::vector<Matrix2D> sampled(exponents.size(), Matrix2D(IMAGE_SIZE / 2, std::vector<bool>(IMAGE_SIZE / 2)));
+    for (std::size_t j = 0; j < exponents.size(); j++)
+        for (std::size_t x = 0; x < IMAGE_SIZE / 2; x++)
+            for (std::size_t y = 0; y < IMAGE_SIZE / 2; y++)
+                sampled[j][x][y] = reference[j][2 * x][2 * y];
+    compare("progressive", sampled, false, [&](std::size_t j) {
+        Matrix2D level;
+        for (unsigned int resolution = PREVIEW_RESOLUTION; resolution < IMAGE_SIZE; resolution *= 2)
+            level = renderLevel(level, resolution, exponents[j]);
+        return level;
+    });
+
+    //the converter works on the reference stack, through the slice files
+    mkdir(SLICE_DIRECTORY, 0755);
+    std::vector<std::string> files;
+    for (std::size_t j = 0; j < reference.size(); j++)
+    {
+        files.push_back(std::string(SLICE_DIRECTORY) + "/" + getFilename(exponents[j]));
+        writeMatrix(reference[j], files.back());
+    }
+
+    Volume volume = stackSlices(reference);
+    try
+    {
+        passed &= report("slice files", isSameVolume(readMatrix(files, IMAGE_SIZE), volume), "");
+    }
+    catch (const std::runtime_error& error)
+    {
+        passed &= report("slice files", false, error.what());
+    }
+
+    Volume labelled = volume;
+    ComponentLabels labels(volume);
+    labels.keep(labelled, selectComponents(labels.getComponents(), 0));
+    std::size_t seedD, seedX, seedY;
+    if (!findSeed(labelled, seedD, seedX, seedY))
+    {
+        report("component labels", false, "the stack is empty");
+        return EXIT_FAILURE;
+    }
+
+    Volume filled = fillReference(volume, seedD, seedX, seedY);
+    passed &= report("component labels", isSameVolume(labelled, filled), "");
+    Volume seeded = volume;
+    removeIslands(seeded, seedD, seedX, seedY);
+    passed &= report("seed fill", isSameVolume(seeded, filled), "");
+    Volume sealed = filled;
+    std::size_t cavities = fillCavities(sealed);
+    passed &= report("cavity fill", isSameVolume(sealed, fillCavitiesReference(filled)),
+        std::to_string(cavities) + " voxels filled");
+
+    Octree octree(filled, MIN_BOX_SIZE);
+    std::string coverage = checkCoverage(filled, mergeRuns(octree.getFullNodes()), MIN_BOX_SIZE);
+    passed &= report("octree boxes", coverage.empty(), coverage);
+    std::vector<Bounds2D> cuboids = findCuboids(filled, MIN_BOX_SIZE);
+    coverage = checkCoverage(filled, cuboids, MIN_BOX_SIZE);
+    passed &= report("greedy boxes", coverage.empty(), coverage);
+
+    //neighbouring rows of each slice, united and intersected as runs and as pixels
+    std::size_t wrongRows = 0;
+    for (const auto& slice : reference)
+    {
+        for (std::size_t x = 0; x + 1 < slice.size(); x++)
+        {
+            std::vector<bool> either(IMAGE_SIZE), both(IMAGE_SIZE);
+            for (std::size_t y = 0; y < IMAGE_SIZE; y++)
+            {
+                either[y] = slice[x][y] || slice[x + 1][y];
+                both[y] = slice[x][y] && slice[x + 1][y];
+            }
+
+            IntervalVolume::Row a = toRow(slice[x]), b = toRow(slice[x + 1]);
+            wrongRows += !sameRuns(uniteRows(a, b), toRow(either));
+            wrongRows += !sameRuns(intersectRows(a, b), toRow(both));
+        }
+    }
+    passed &= report("interval rows", wrongRows == 0, std::to_string(wrongRows) + " rows differ");
+
+    IntervalVolume intervals = readIntervals(files, IMAGE_SIZE);
+    intervals.keep(selectComponents(intervals.findComponents(), 0));
+    passed &= report("interval boxes", sameBoxes(intervals.findCuboids(MIN_BOX_SIZE), cuboids), "");
+
+    for (bool greedy : { false, true })
+    {
+        SlabStream stream(files, IMAGE_SIZE, SLAB_HEIGHT, MIN_BOX_SIZE, greedy);
+        stream.run();
+        std::vector<Bounds2D> boxes;
+        stream.getKeptBoxes(selectComponents(stream.getComponents(), 0))([&](const Bounds2D& box) {
+            boxes.push_back(box);
+        });
+        coverage = checkCoverage(filled, boxes, MIN_BOX_SIZE);
+        passed &= report(greedy ? "streamed greedy boxes" : "streamed boxes", coverage.empty(), coverage);
+    }
+
+    SlabStream budgeted(files, IMAGE_SIZE, files.size(), MIN_BOX_SIZE, false);
+    budgeted.setMemoryBudget(STREAM_BUDGET);
+    budgeted.run();
+    std::vector<Bounds2D> streamed;
+    BoxSource kept = budgeted.getKeptBoxes(selectComponents(budgeted.getComponents(), 0));
+    kept([&](const Bounds2D& box) {
+        streamed.push_back(box);
+    });
+    coverage = checkCoverage(filled, streamed, MIN_BOX_SIZE);
+    passed &= report("budgeted stream", coverage.empty() && budgeted.getPeakBytes() <= STREAM_BUDGET,
+        coverage + std::to_string(budgeted.getSlabCount()) + " slabs, peak " +
+        std::to_string(budgeted.getPeakBytes() >> 10) + " KB");
+
+    std::string whole = std::string(SLICE_DIRECTORY) + "/whole.bin", buffered = std::string(SLICE_DIRECTORY) + "/buffered.bin";
+    writeBinaryGeometry(streamed, files.size(), IMAGE_SIZE, whole);
+    writeBinaryGeometry(kept, files.size(), IMAGE_SIZE, buffered, WRITE_BUFFER);
+    passed &= report("buffered geometry file", readWholeFile(whole) == readWholeFile(buffered), "");
+    std::remove(whole.c_str());
+    std::remove(buffered.c_str());
+
+    //the full boxes and the coarser levels' larger ones, as writeLevels scales them
+    std::size_t overruns = 0;
+    Volume level = filled;
+    for (std::size_t halvings = 0; halvings < LEVEL_CHECKS; halvings++)
+    {
+        std::vector<Bounds2D> boxes = cuboids;
+        if (halvings > 0)
+        {
+            level = downsample(level);
+            boxes = findCuboids(level, std::max(MIN_BOX_SIZE >> halvings, (std::size_t)1));
+            for (auto& box : boxes)
+            {
+                box.first = Point3D(box.first.d_ << halvings, box.first.x_ << halvings, box.first.y_ << halvings);
+                box.second = Point3D(box.second.d_ << halvings, box.second.x_ << halvings, box.second.y_ << halvings);
+            }
+        }
+
+        writeBinaryGeometry(boxes, files.size(), IMAGE_SIZE, whole);
+        GeometryFile file(whole);
+        overruns += file.isOpen() ? countBrickOverruns(file) : 1;
+        std::remove(whole.c_str());
+    }
+    passed &= report("bricked levels", overruns == 0, std::to_string(overruns) + " records past their brick");
+
+    try
+    {
+        SlabStream starved(files, IMAGE_SIZE, files.size(), MIN_BOX_SIZE, false);
+        starved.setMemoryBudget(1 << 10);
+        starved.run();
+        passed &= report("starved stream", false, "ran within a budget of 1 KB");
+    }
+    catch (const std::runtime_error& error)
+    {
+        passed &= report("starved stream", true, error.what());
+    }
+
+    for (const auto& file : files)
+        std::remove(file.c_str());
+
+    std::cout << (passed ? "All checks passed." : "Some checks FAILED.") << std::endl;
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+
+//the escape-time loop as the generator first had it, to hold faster versions to
+bool isInsideReference(float x, float y, float d)
+{
+    std::complex<float> c(x, y);
+    std::complex<float> z(0, 0);
+
+    for (unsigned int i = 0; i < REFERENCE_DEPTH; i++)
+    {
+        if (norm(z) >= 4)
+            return false;
+        z = pow(z, d) + c;
+    }
+
+    return true;
+}
+
+
+
+Matrix2D renderReference(float d)
+{
+    Matrix2D matrix;
+    initializeMatrix(matrix);
+    for (unsigned int x = 0; x < IMAGE_SIZE; x++)
+        for (unsigned int y = 0; y < IMAGE_SIZE; y++)
+            matrix[x][y] = isInsideReference(4.0f * x / IMAGE_SIZE - 2, 4.0f * y / IMAGE_SIZE - 2, d);
+    return matrix;
+}
+
+
+
+std::size_t countMismatches(const Matrix2D& a, const Matrix2D& b)
+{
+    std::size_t mismatches = 0;
+    for (std::size_t x = 0; x < a.size(); x++)
+        for (std::size_t y = 0; y < a[x].size(); y++)
+            mismatches += a[x][y] != b[x][y];
+    return mismatches;
+}
+
+
+
+//pixels with a 4-neighbour on the other side of the surface
+std::size_t countBoundary(const Matrix2D& matrix)
+{
+    std::size_t boundary = 0;
+    for (std::size_t x = 0; x < matrix.size(); x++)
+    {
+        for (std::size_t y = 0; y < matrix[x].size(); y++)
+        {
+            bool state = matrix[x][y];
+            if ((x > 0 && matrix[x - 1][y] != state) || (x + 1 < matrix.size() && matrix[x + 1][y] != state) ||
+                (y > 0 && matrix[x][y - 1] != state) || (y + 1 < matrix[x].size() && matrix[x][y + 1] != state))
+                boundary++;
+        }
+    }
+
+    return boundary;
+}
+
+
+
+Volume stackSlices(const std::vector<Matrix2D>& slices)
+{
+    Volume volume(slices.size(), IMAGE_SIZE);
+    for (std::size_t d = 0; d < slices.size(); d++)
+        for (std::size_t x = 0; x < IMAGE_SIZE; x++)
+            for (std::size_t y = 0; y < IMAGE_SIZE; y++)
+                if (slices[d][x][y])
+                    volume.set(d, x, y);
+    return volume;
+}
+
+
+
+//the 6-connected component of the seed, found one voxel at a time
+Volume fillReference(const Volume& volume, std::size_t seedD, std::size_t seedX, std::size_t seedY)
+{
+    const std::size_t height = volume.getHeight(), size = volume.getSize();
+    Volume filled(height, size);
+    std::vector<std::array<std::size_t, 3>> pending(1, {{ seedD, seedX, seedY }});
+    filled.set(seedD, seedX, seedY);
+
+    while (!pending.empty())
+    {
+        std::array<std::size_t, 3> voxel = pending.back();
+        pending.pop_back();
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            for (std::size_t offset : { (std::size_t)1, ~(std::size_t)0 }) //out of range wraps to huge
+            {
+                std::array<std::size_t, 3> next = voxel;
+                next[(std::size_t)axis] += offset;
+                if (next[0] >= height || next[1] >= size || next[2] >= size)
+                    continue;
+
+                if (volume.get(next[0], next[1], next[2]) && !filled.get(next[0], next[1], next[2]))
+                {
+                    filled.set(next[0], next[1], next[2]);
+                    pending.push_back(next);
+                }
+            }
+        }
+    }
+
+    return filled;
+}
+
+
+
+//the volume with every empty voxel that the faces do not reach, found one voxel at a time
+Volume fillCavitiesReference(const Volume& volume)
+{
+    const std::size_t height = volume.getHeight(), size = volume.getSize();
+    Volume outside(height, size);
+    std::vector<std::array<std::size_t, 3>> pending;
+    auto reach = [&](std::size_t d, std::size_t x, std::size_t y) {
+        if (d < height && x < size && y < size && !volume.get(d, x, y) && !outside.get(d, x, y))
+        {
+            outside.set(d, x, y);
+            pending.push_back({{ d, x, y }});
+        }
+    };
+
+    for (std::size_t d = 0; d < height; d++)
+        for (std::size_t x = 0; x < size; x++)
+            for (std::size_t y = 0; y < size; y++)
+                if (d == 0 || x == 0 || y == 0 || d + 1 == height || x + 1 == size || y + 1 == size)
+                    reach(d, x, y);
+
+    while (!pending.empty())
+    {
+        std::array<std::size_t, 3> voxel = pending.back();
+        pending.pop_back();
+        reach(voxel[0] - 1, voxel[1], voxel[2]); //out of range wraps to huge
+        reach(voxel[0] + 1, voxel[1], voxel[2]);
+        reach(voxel[0], voxel[1] - 1, voxel[2]);
+        reach(voxel[0], voxel[1] + 1, voxel[2]);
+        reach(voxel[0], voxel[1], voxel[2] - 1);
+        reach(voxel[0], voxel[1], voxel[2] + 1);
+    }
+
+    Volume sealed(height, size);
+    for (std::size_t d = 0; d < height; d++)
+        for (std::size_t x = 0; x < size; x++)
+            for (std::size_t y = 0; y < size; y++)
+                if (!outside.get(d, x, y))
+                    sealed.set(d, x, y);
+    return sealed;
+}
+
+
+
+//the runs of inside pixels along a row
+IntervalVolume::Row toRow(const std::vector<bool>& pixels)
+{
+    IntervalVolume::Row row;
+    for (std::uint32_t y = 0; y < (std::uint32_t)pixels.size(); y++)
+    {
+        if (!pixels[y])
+            continue;
+        if (!row.empty() && row.back().end_ == y)
+            row.back().end_++;
+        else
+            row.push_back(Run(y, y + 1));
+    }
+
+    return row;
+}
+
+
+
+bool sameRuns(const IntervalVolume::Row& a, const IntervalVolume::Row& b)
+{
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](const Run& p, const Run& q) {
+        return p.start_ == q.start_ && p.end_ == q.end_;
+    });
+}
+
+
+
+//whether both are the same boxes, in any order
+bool sameBoxes(std::vector<Bounds2D> a, std::vector<Bounds2D> b)
+{
+    auto byCorners = [](const Bounds2D& p, const Bounds2D& q) {
+        return std::make_tuple(p.first.d_, p.first.x_, p.first.y_, p.second.d_, p.second.x_, p.second.y_) <
+            std::make_tuple(q.first.d_, q.first.x_, q.first.y_, q.second.d_, q.second.x_, q.second.y_);
+    };
+
+    std::sort(a.begin(), a.end(), byCorners);
+    std::sort(b.begin(), b.end(), byCorners);
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](const Bounds2D& p, const Bounds2D& q) {
+        return p.first.d_ == q.first.d_ && p.first.x_ == q.first.x_ && p.first.y_ == q.first.y_ &&
+            p.second.d_ == q.second.d_ && p.second.x_ == q.second.x_ && p.second.y_ == q.second.y_;
+    });
+}
+
+
+
+//counts the records that reach past the brick they are filed under
+std::size_t countBrickOverruns(const GeometryFile& file)
+{
+    const GeometryHeader& header = file.getHeader();
+    const int brickSize = (int)header.brickSize_;
+    std::size_t overruns = 0;
+    for (std::size_t j = 0; j < file.getBrickCount(); j++)
+    {
+        const BrickEntry& brick = file.getBricks()[j];
+        const BoxRecord* boxes = file.getBrickBoxes(brick);
+        std::size_t index = getBrickIndex(boxes[0], header.size_, header.brickSize_);
+        for (std::size_t k = 0; k < brick.boxCount_; k++)
+        {
+            const BoxRecord& box = boxes[k];
+            overruns += getBrickIndex(box, header.size_, header.brickSize_) != index ||
+                box.d0_ / brickSize != (box.d1_ - 1) / brickSize || box.x0_ / brickSize != (box.x1_ - 1) / brickSize ||
+                box.y0_ / brickSize != (box.y1_ - 1) / brickSize;
+        }
+    }
+
+    return overruns;
+}
+
+
+
+bool report(const std::string& check, bool passed, const std::string& detail)
+{
+    std::cout << (passed ? "PASS  " : "FAIL  ") << check;
+    if (!detail.empty())
+        std::cout << ": " << detail;
+    std::cout << std::endl;
+    return passed;
+}
@@ -0,0 +1,42 @@
+#ifndef REGRESSION
+#define REGRESSION
+
+/**
+    The regression check renders a reduced stack, 128^2 pixels at 16 of 64
+    heights by default, with a plain escape-time loop kept here as the
+    reference, and holds the generator's and converter's faster paths to
+    it. It is built with REDUCED_SIZE, which shrinks the generator's image.
+
+    Paths that only compute the same thing another way must agree bit for
+    bit: isInsideFractal, the distance channel and distance skipping against
+    the plain rendering, slices written and read back, the seed fill, the
+    component labels and the cavity fill against voxel by voxel flood fills,
+    the boxes against the volume they cover, and the run-based rows and
+    boxes against the bit-based ones, and every level's binary records
+    within their bricks. The chunk border shortcut and the
+    progressive previews take pixels from their neighbours instead and
+    may differ along the surface. They pass while their mismatched pixels
+    stay under MAX_BOUNDARY_MISMATCH of the reference's boundary pixels,
+    those with a 4-neighbour on the other side.
+**/
+
+#include "../Converter/main.hpp"
+#include "Slices.hpp"
+#include "IntervalVolume.hpp"
+#include <vector>
+#include <string>
+
+bool isInsideReference(float x, float y, float d);
+Matrix2D renderReference(float d);
+std::size_t countMismatches(const Matrix2D& a, const Matrix2D& b);
+std::size_t countBoundary(const Matrix2D& matrix);
+Volume stackSlices(const std::vector<Matrix2D>& slices);
+Volume fillReference(const Volume& volume, std::size_t seedD, std::size_t seedX, std::size_t seedY);
+Volume fillCavitiesReference(const Volume& volume);
+IntervalVolume::Row toRow(const std::vector<bool>& pixels);
+bool sameRuns(const IntervalVolume::Row& a, const IntervalVolume::Row& b);
+bool sameBoxes(std::vector<Bounds2D> a, std::vector<Bounds2D> b);
+std::size_t countBrickOverruns(const GeometryFile& file);
+bool report(const std::string& check, bool passed, const std::string& detail);
+
+#endif
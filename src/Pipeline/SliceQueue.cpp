@@ -0,0 +1,42 @@
+
+#include "SliceQueue.hpp"
+#include <algorithm>
+
+
+SliceQueue::SliceQueue(std::size_t capacity) :
+    capacity_(std::max(capacity, (std::size_t)1)), next_(0), peakHeld_(0)
+{}
+
+
+
+//blocks until the layer is within capacity of the next to be popped
+void SliceQueue::push(std::size_t index, Layer layer)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [&]() { return index < next_ + capacity_; });
+
+    held_[index] = std::move(layer);
+    peakHeld_ = std::max(peakHeld_, held_.size());
+    changed_.notify_all();
+}
+
+
+
+//blocks until the next layer in height order has been pushed
+SliceQueue::Layer SliceQueue::pop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [&]() { return held_.count(next_) > 0; });
+
+    Layer layer = std::move(held_[next_]);
+    held_.erase(next_++);
+    changed_.notify_all();
+    return layer;
+}
+
+
+
+std::size_t SliceQueue::getPeakHeld() const
+{
+    return peakHeld_;
+}
@@ -0,0 +1,38 @@
+#ifndef SLICE_QUEUE
+#define SLICE_QUEUE
+
+/**
+    A SliceQueue hands the pipeline's rendered slices to the converter in
+    height order, whatever order the renderers finish them in. Renderers
+    push each slice under its layer index, and the converter pops layers
+    one after another, waiting for the next one if it is still being
+    rendered. A renderer may only push a layer within the queue's capacity
+    of the next one to be popped, and otherwise waits for the converter to
+    catch up, so no more than that many finished slices are ever held.
+**/
+
+#include "Volume.hpp"
+#include <vector>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+
+class SliceQueue
+{
+    public:
+        typedef std::vector<Volume::Word> Layer; //the rows of a layer, one after another
+
+        SliceQueue(std::size_t capacity);
+
+        void push(std::size_t index, Layer layer);
+        Layer pop();
+        std::size_t getPeakHeld() const;
+
+    private:
+        std::mutex mutex_;
+        std::condition_variable changed_;
+        std::map<std::size_t, Layer> held_; //finished, but not yet popped
+        std::size_t capacity_, next_, peakHeld_;
+};
+
+#endif
@@ -0,0 +1,10 @@
+#!/bin/sh
+#use OpenMPI-GCC-4.8
+C=../Converter
+if (g++ -O3 --std=c++11 -pthread -I. -I$C "-I../Multibrot generator" -I../Shared main.cpp SliceQueue.cpp "../Multibrot generator/Slices.cpp" $C/Stages.cpp $C/Volume.cpp $C/Octree.cpp $C/Greedy.cpp $C/SurfaceMesh.cpp $C/SlabStream.cpp $C/Components.cpp $C/Parallel.cpp $C/SliceReader.cpp $C/IntervalVolume.cpp $C/ConversionCache.cpp $C/CacheMisses.cpp $C/StageLog.cpp $C/DistanceField.cpp -o pipeline) then
+    echo "Compilation success."
+    exit 0
+else
+    echo "Compilation failure."
+    exit 1
+fi
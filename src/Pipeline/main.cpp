@@ -0,0 +1,144 @@
+#include "main.hpp"
+#include "SlabStream.hpp"
+#include "Parallel.hpp"
+#include "StageLog.hpp"
+#include <thread>
+#include <atomic>
+#include <stdexcept>
+#include <algorithm>
+#include <iostream>
+#include <cstdlib>
+#include <cstdio>
+
+
+const std::size_t MIN_BOX_SIZE = 4; //smaller boxes are left out of the geometry
+const std::size_t SLAB_HEIGHT = 32; //layers converted at once
+const char* const LOG_FILE = "stages.log";
+
+
+/*
+    Renders the Multibrot slices and converts them into geometry in the same
+    process. Renderer threads hand their slices over in memory as they are
+    finished, while the converter streams them in slabs, so that no slice
+    files are needed and the conversion overlaps the rendering.
+*/
+int main(int argc, char** argv)
+{
+    std::vector<Slice> slices = planUniformSlices();
+    if (hasFlag(argc, argv, "--adaptive"))
+        slices = planAdaptiveSlices(getOption(argc, argv, "--adaptive", (unsigned int)MAX_HEIGHT));
+
+    bool writeSlices = hasFlag(argc, argv, "--write-slices");
+    if (writeSlices)
+        writeManifest(slices, "slices.dat");
+
+    setThreadCount(getOption(argc, argv, "--threads", 0));
+    std::size_t renderers = getOption(argc, argv, "--renderers", (unsigned int)getThreadCount());
+    std::size_t slabHeight = getOption(argc, argv, "--slab-height", SLAB_HEIGHT);
+    slabHeight = std::max(slabHeight / MIN_BOX_SIZE * MIN_BOX_SIZE, MIN_BOX_SIZE);
+    std::size_t minSize = getOption(argc, argv, "--min-component-size", 0);
+
+    //by default the renderers may run a slab ahead of the converter
+    SliceQueue queue(getOption(argc, argv, "--queue-slices", (unsigned int)(2 * slabHeight)));
+    std::cout << "Rendering " << slices.size() << " slices on " << renderers <<
+        " threads, converting slabs of " << slabHeight << " layers." << std::endl;
+
+    const std::size_t height = slices.size();
+    const std::uint64_t voxels = (std::uint64_t)height * IMAGE_SIZE * IMAGE_SIZE;
+    StageLog log(LOG_FILE);
+    std::thread rendering(renderLayers, std::cref(slices), renderers, writeSlices, std::ref(queue));
+
+    SlabStream stream([&](std::size_t minD, std::size_t maxD) {
+        return takeSlab(queue, maxD - minD, IMAGE_SIZE);
+    }, height, IMAGE_SIZE, slabHeight, MIN_BOX_SIZE, hasFlag(argc, argv, "--greedy"));
+    log.begin("pipeline", voxels);
+    stream.run();
+    rendering.join();
+
+    const std::vector<Component>& components = stream.getComponents();
+    writeComponents(components, "components.dat");
+    std::vector<bool> kept = selectComponents(components, minSize);
+    std::cout << "Found " << components.size() << " components, kept " <<
+        std::count(kept.begin(), kept.end(), true) << "." << std::endl;
+    log.note("slab_height", slabHeight);
+    log.note("peak_queued_slices", queue.getPeakHeld());
+    log.note("components", components.size());
+    log.end();
+
+    BoxSource boxes = stream.getKeptBoxes(kept);
+    std::cout << "Calculating geometry, ";
+    log.begin("write", 0);
+    std::vector<std::size_t> shapes = countBoxShapes(boxes, MIN_BOX_SIZE);
+    log.note("boxes", shapes[0] + shapes[1] + shapes[2] + shapes[3]);
+    log.note("cubes", shapes[3]);
+    log.note("planes", shapes[2]);
+    log.note("lines", shapes[1]);
+    log.note("points", shapes[0]);
+    std::cout << shapes[3] << " cubes, " << shapes[2] << " planes, " <<
+        shapes[1] << " lines and " << shapes[0] << " points, ";
+    writeGeometry(boxes, std::string("geometry.dat"));
+    writeBinaryGeometry(boxes, height, IMAGE_SIZE, std::string("geometry.bin"), //as many records as a slab has bytes
+        slabHeight * IMAGE_SIZE * IMAGE_SIZE / 8 / sizeof(BoxRecord));
+    std::remove(getLevelFilename(1).c_str()); //no coarser levels without the whole volume
+    log.end();
+    std::cout << "finished." << std::endl;
+
+    std::cout << "Program complete." << std::endl;
+    return EXIT_SUCCESS;
+}
+
+
+
+//packs a rendered slice into the words of one volume layer
+SliceQueue::Layer packLayer(const Matrix2D& matrix)
+{
+    const std::size_t rowWords = (matrix.size() + Volume::WORD_BITS - 1) / Volume::WORD_BITS;
+    SliceQueue::Layer layer(matrix.size() * rowWords, 0);
+    for (std::size_t x = 0; x < matrix.size(); x++)
+        for (std::size_t y = 0; y < matrix[x].size(); y++)
+            if (matrix[x][y])
+                layer[x * rowWords + y / Volume::WORD_BITS] |= (Volume::Word)1 << (y % Volume::WORD_BITS);
+    return layer;
+}
+
+
+
+//renders the slices on several threads, each taking the lowest slice not yet taken
+void renderLayers(const std::vector<Slice>& slices, std::size_t renderers, bool writeSlices, SliceQueue& queue)
+{
+    std::atomic<std::size_t> next(0);
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < std::max(renderers, (std::size_t)1); t++)
+    {
+        threads.push_back(std::thread([&]() {
+            DistanceMatrix distances; //left empty, so every pixel is rendered
+            for (std::size_t j = next++; j < slices.size(); j = next++)
+            {
+                Matrix2D matrix = renderSlice(slices[j].d_, distances, false);
+                if (writeSlices)
+                    writeMatrix(matrix, getFilename(slices[j].d_));
+                queue.push(j, packLayer(matrix));
+            }
+        }));
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+}
+
+
+
+//the next layers of the stack, in order, as a slab
+Volume takeSlab(SliceQueue& queue, std::size_t height, std::size_t size)
+{
+    Volume slab(height, size);
+    for (std::size_t d = 0; d < height; d++)
+    {
+        SliceQueue::Layer layer = queue.pop();
+        for (std::size_t x = 0; x < size; x++)
+            for (std::size_t w = 0; w < slab.getRowWords(); w++)
+                slab.getWord(d, x, w) = layer[x * slab.getRowWords() + w];
+    }
+
+    return slab;
+}
@@ -0,0 +1,11 @@
+#ifndef PIPELINE
+#define PIPELINE
+
+#include "SliceQueue.hpp"
+#include "Slices.hpp"
+
+SliceQueue::Layer packLayer(const Matrix2D& matrix);
+void renderLayers(const std::vector<Slice>& slices, std::size_t renderers, bool writeSlices, SliceQueue& queue);
+Volume takeSlab(SliceQueue& queue, std::size_t height, std::size_t size);
+
+#endif
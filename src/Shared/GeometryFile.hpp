@@ -0,0 +1,314 @@
+
+#ifndef GEOMETRY_FILE
+#define GEOMETRY_FILE
+
+/**
+    The binary form of the converter's box list, shared with the renderer.
+    A GeometryHeader comes first, then an index of brickCount_ BrickEntries,
+    then boxCount_ packed BoxRecords. Each record is the minimum and maximum
+    corner of a solid box in voxels, in the same order as the text
+    geometry's "flag d0 x0 y0 d1 x1 y1" lines, minus the flag, which is
+    always 4. The header's histogram counts boxes by the power of two just
+    below their smallest side, so a reader can size its buckets before it
+    touches the records.
+
+    The records are grouped into cubic bricks of brickSize_ voxels, and
+    only bricks with boxes are indexed. Boxes are cut at every brick edge
+    before they are written, so each record lies within its brick and a
+    brick is closed on its own. An entry gives the brick's boxes as a byte
+    offset into the file and a count, along with their bounds. A reader can
+    then cull or load bricks without looking at their boxes.
+
+    Coarser levels of detail are written alongside in the same format, one
+    file per level, each from the volume downsampled by another factor of
+    two but with its boxes in full-resolution voxels and cut at the same
+    brick edges. Their bricks therefore line up with the full geometry's,
+    and a reader can swap levels brick by brick without holes or overlaps
+    at the seams.
+
+    GeometryFile maps a file into memory and hands out its records where
+    they lie, so reading costs no more than the pages it touches.
+**/
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+const std::size_t SIZE_CLASSES = 16; //smallest side 1, 2, 4, ..., 2^15
+
+#pragma pack(push, 1)
+struct GeometryHeader
+{
+    char magic_[4]; //"MBG2"
+    std::uint32_t height_, size_; //volume dimensions in voxels
+    std::uint32_t brickSize_, brickCount_;
+    std::uint32_t boxCount_;
+    std::uint32_t sizeClasses_[SIZE_CLASSES];
+};
+
+struct BoxRecord
+{
+    std::int16_t d0_, x0_, y0_, d1_, x1_, y1_;
+};
+
+struct BrickEntry
+{
+    BoxRecord bounds_; //of the brick's boxes
+    std::uint32_t boxCount_;
+    std::uint64_t offset_; //of the first box, from the start of the file
+};
+#pragma pack(pop)
+
+
+
+//returns k such that 2^k <= the smallest side of the box < 2^(k + 1)
+inline std::size_t getSizeClass(const BoxRecord& box)
+{
+    int smallest = std::min(box.d1_ - box.d0_, std::min(box.x1_ - box.x0_, box.y1_ - box.y0_));
+    std::size_t sizeClass = 0;
+    while (sizeClass + 1 < SIZE_CLASSES && (2 << sizeClass) <= smallest)
+        sizeClass++;
+    return sizeClass;
+}
+
+
+
+//returns the brick holding the box's minimum corner, numbered d-major
+inline std::size_t getBrickIndex(const BoxRecord& box, std::size_t size, std::size_t brickSize)
+{
+    std::size_t bricksPerSide = (size + brickSize - 1) / brickSize;
+    return ((box.d0_ / brickSize) * bricksPerSide + box.x0_ / brickSize) * bricksPerSide + box.y0_ / brickSize;
+}
+
+
+
+//level 0 is the full geometry, each further level halves its resolution
+inline std::string getLevelFilename(std::size_t level)
+{
+    if (level == 0)
+        return "geometry.bin";
+    return "geometry.lod" + std::to_string(level) + ".bin";
+}
+
+
+
+typedef std::function<void(const BoxRecord&)> RecordVisitor;
+typedef std::function<void(const RecordVisitor&)> RecordSource; //visits the same records in the same order on every call
+
+
+
+//visits the parts of the box within each brick it reaches, in d, x, y order
+inline void splitAtBricks(const BoxRecord& box, std::size_t brickSize, const RecordVisitor& visit)
+{
+    const int brick = (int)brickSize;
+    auto next = [brick](int at) { return (at / brick + 1) * brick; };
+    for (int d = box.d0_; d < box.d1_; d = next(d))
+        for (int x = box.x0_; x < box.x1_; x = next(x))
+            for (int y = box.y0_; y < box.y1_; y = next(y))
+                visit(BoxRecord{(std::int16_t)d, (std::int16_t)x, (std::int16_t)y,
+                    (std::int16_t)std::min((int)box.d1_, next(d)), (std::int16_t)std::min((int)box.x1_, next(x)),
+                    (std::int16_t)std::min((int)box.y1_, next(y))});
+}
+
+
+
+/*
+    Writes the records that the source visits, cut at the brick edges and
+    kept in their order within a brick. The first call indexes the bricks,
+    and each further call places the records of as many whole bricks as fit
+    in bufferRecords, so the records are never all held at once unless the
+    buffer is that large.
+*/
+inline bool writeGeometryFile(const std::string& filename, std::size_t height,
+    std::size_t size, std::size_t brickSize, const RecordSource& source, std::size_t bufferRecords)
+{
+    auto forEach = [&](const RecordVisitor& visit) {
+        source([&](const BoxRecord& box) {
+            splitAtBricks(box, brickSize, visit);
+        });
+    };
+
+    std::size_t bricksPerSide = (size + brickSize - 1) / brickSize;
+    std::size_t brickLayers = (height + brickSize - 1) / brickSize;
+    std::vector<BrickEntry> all(brickLayers * bricksPerSide * bricksPerSide, BrickEntry{BoxRecord(), 0, 0});
+
+    GeometryHeader header;
+    std::memcpy(header.magic_, "MBG2", 4);
+    header.height_ = (std::uint32_t)height;
+    header.size_ = (std::uint32_t)size;
+    header.brickSize_ = (std::uint32_t)brickSize;
+    header.boxCount_ = 0;
+    std::fill(header.sizeClasses_, header.sizeClasses_ + SIZE_CLASSES, 0);
+    forEach([&](const BoxRecord& box) {
+        BrickEntry& brick = all[getBrickIndex(box, size, brickSize)];
+        if (brick.boxCount_++ == 0)
+            brick.bounds_ = box;
+
+        BoxRecord& bounds = brick.bounds_;
+        bounds.d0_ = std::min(bounds.d0_, box.d0_), bounds.d1_ = std::max(bounds.d1_, box.d1_);
+        bounds.x0_ = std::min(bounds.x0_, box.x0_), bounds.x1_ = std::max(bounds.x1_, box.x1_);
+        bounds.y0_ = std::min(bounds.y0_, box.y0_), bounds.y1_ = std::max(bounds.y1_, box.y1_);
+        header.sizeClasses_[getSizeClass(box)]++;
+        header.boxCount_++;
+    });
+
+    //the first record of each brick, counted in records, then only the bricks with boxes
+    std::vector<std::uint64_t> next(all.size(), 0);
+    std::vector<BrickEntry> bricks;
+    std::uint64_t records = 0;
+    for (std::size_t j = 0; j < all.size(); j++)
+    {
+        next[j] = records;
+        records += all[j].boxCount_;
+        if (all[j].boxCount_ > 0)
+            bricks.push_back(BrickEntry{all[j].bounds_, all[j].boxCount_, next[j]});
+    }
+    header.brickCount_ = (std::uint32_t)bricks.size();
+
+    std::uint64_t firstBox = sizeof(GeometryHeader) + bricks.size() * sizeof(BrickEntry);
+    for (auto& brick : bricks)
+        brick.offset_ = firstBox + brick.offset_ * sizeof(BoxRecord);
+
+    std::ofstream fout;
+    fout.open(filename, std::ofstream::out | std::ofstream::binary);
+    fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    fout.write(reinterpret_cast<const char*>(bricks.data()), (std::streamsize)(bricks.size() * sizeof(BrickEntry)));
+
+    //a brick larger than the buffer still goes in whole
+    std::vector<BoxRecord> buffer;
+    for (std::size_t first = 0, last = 0; first < all.size(); first = last)
+    {
+        std::uint64_t buffered = 0;
+        while (last < all.size() && (buffered == 0 || buffered + all[last].boxCount_ <= bufferRecords))
+            buffered += all[last++].boxCount_;
+        if (buffered == 0)
+            continue;
+
+        std::uint64_t start = next[first];
+        buffer.resize((std::size_t)buffered);
+        forEach([&](const BoxRecord& box) {
+            std::size_t brick = getBrickIndex(box, size, brickSize);
+            if (first <= brick && brick < last)
+                buffer[(std::size_t)(next[brick]++ - start)] = box;
+        });
+        fout.write(reinterpret_cast<const char*>(buffer.data()), (std::streamsize)(buffer.size() * sizeof(BoxRecord)));
+    }
+
+    fout.close();
+    return !fout.fail();
+}
+
+
+
+inline bool writeGeometryFile(const std::string& filename, std::size_t height,
+    std::size_t size, std::size_t brickSize, const std::vector<BoxRecord>& boxes)
+{
+    return writeGeometryFile(filename, height, size, brickSize, [&](const RecordVisitor& visit) {
+        for (const auto& box : boxes)
+            visit(box);
+    }, boxes.size());
+}
+
+
+
+class GeometryFile
+{
+    public:
+        GeometryFile(const std::string& filename) :
+            data_(nullptr), length_(0)
+        {
+            int descriptor = open(filename.c_str(), O_RDONLY);
+            if (descriptor < 0)
+                return;
+
+            struct stat status;
+            if (fstat(descriptor, &status) == 0 && (std::size_t)status.st_size >= sizeof(GeometryHeader))
+            {
+                length_ = (std::size_t)status.st_size;
+                void* data = mmap(nullptr, length_, PROT_READ, MAP_PRIVATE, descriptor, 0);
+                data_ = data == MAP_FAILED ? nullptr : static_cast<const char*>(data);
+            }
+
+            close(descriptor);
+
+            if (data_ != nullptr && !isValid())
+            {
+                munmap(const_cast<char*>(data_), length_);
+                data_ = nullptr;
+            }
+        }
+
+        ~GeometryFile()
+        {
+            if (data_ != nullptr)
+                munmap(const_cast<char*>(data_), length_);
+        }
+
+        GeometryFile(const GeometryFile&) = delete;
+        GeometryFile& operator=(const GeometryFile&) = delete;
+
+        //false if the file is missing, truncated, or not geometry
+        bool isOpen() const
+        {
+            return data_ != nullptr;
+        }
+
+        const GeometryHeader& getHeader() const
+        {
+            return *reinterpret_cast<const GeometryHeader*>(data_);
+        }
+
+        const BrickEntry* getBricks() const
+        {
+            return reinterpret_cast<const BrickEntry*>(data_ + sizeof(GeometryHeader));
+        }
+
+        std::size_t getBrickCount() const
+        {
+            return getHeader().brickCount_;
+        }
+
+        //all boxes, brick after brick
+        const BoxRecord* getBoxes() const
+        {
+            return reinterpret_cast<const BoxRecord*>(data_ + sizeof(GeometryHeader) +
+                getBrickCount() * sizeof(BrickEntry));
+        }
+
+        std::size_t getBoxCount() const
+        {
+            return getHeader().boxCount_;
+        }
+
+        const BoxRecord* getBrickBoxes(const BrickEntry& brick) const
+        {
+            return reinterpret_cast<const BoxRecord*>(data_ + brick.offset_);
+        }
+
+    private:
+        bool isValid() const
+        {
+            if (std::memcmp(getHeader().magic_, "MBG2", 4) != 0 || length_ != sizeof(GeometryHeader) +
+                getBrickCount() * sizeof(BrickEntry) + getBoxCount() * sizeof(BoxRecord))
+                return false;
+
+            for (std::size_t j = 0; j < getBrickCount(); j++)
+                if (getBricks()[j].offset_ + getBricks()[j].boxCount_ * sizeof(BoxRecord) > length_)
+                    return false;
+            return true;
+        }
+
+    private:
+        const char* data_;
+        std::size_t length_;
+};
+
+#endif